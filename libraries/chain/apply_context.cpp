@@ -41,13 +41,17 @@ apply_context::exec_one() {
     r.act_digest      = digest_type::hash(act);
     r.global_sequence = next_global_sequence();
 
-    auto t    = action_trace(r);
+    auto t = action_trace(r);
+    trx_context.executed.emplace_back(std::move(r));
+
+    if(!trx_context.record_traces) {
+        return t;
+    }
+
     t.trx_id  = trx_context.trx.id;
     t.act     = act;
     t.console = _pending_console_output.str();
 
-    trx_context.executed.emplace_back(std::move(r));
-    
     print_debug(t);
     reset_console();
 
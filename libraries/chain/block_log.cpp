@@ -4,74 +4,855 @@
 */
 #include <vros/chain/block_log.hpp>
 #include <vros/chain/exceptions.hpp>
+#include <fc/io/fstream.hpp>
 #include <fc/io/raw.hpp>
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
 
 #define LOG_READ (std::ios::in | std::ios::binary)
 #define LOG_WRITE (std::ios::out | std::ios::binary | std::ios::app)
 
 namespace vros { namespace chain {
 
-const uint32_t block_log::supported_version = 1;
+const uint32_t block_log::min_supported_version = 1;
+const uint32_t block_log::supported_version     = 2;
 
 namespace detail {
+
+namespace bip = boost::interprocess;
+namespace bio = boost::iostreams;
+
+/**
+ * Read-only memory mapping of a log file which only grows by appending.
+ *
+ * A mapping covers the file as it was when mapped, reading beyond it maps the whole file again.
+ * Readers hold the mapping they got by shared pointer, so remapping never unmaps memory still
+ * being read by other threads, the old mapping is released with its last reader.
+ */
+class mapped_log_file {
+public:
+    struct mapping {
+        bip::mapped_region region;
+        uint64_t           size = 0;
+
+        const char* data() const { return (const char*)region.get_address(); }
+
+        uint64_t
+        read_u64(uint64_t pos) const {
+            auto v = uint64_t();
+            memcpy(&v, data() + pos, sizeof(v));
+            return v;
+        }
+    };
+    using mapping_ptr = std::shared_ptr<const mapping>;
+
+public:
+    void
+    open(const fc::path& path) {
+        path_ = path;
+        close();
+    }
+
+    void
+    close() {
+        std::atomic_store(&mapping_, mapping_ptr());
+    }
+
+    mapping_ptr
+    remap() {
+        std::lock_guard<std::mutex> lock(remap_mutex_);
+        return map_file();
+    }
+
+    // returns a mapping covering first `size` bytes, or nullptr if the file is smaller
+    mapping_ptr
+    ensure(uint64_t size) {
+        auto m = std::atomic_load(&mapping_);
+        if(m && m->size >= size) {
+            return m;
+        }
+
+        std::lock_guard<std::mutex> lock(remap_mutex_);
+        m = std::atomic_load(&mapping_);
+        if(!m || m->size < size) {
+            // other thread may have remapped it while waiting for the lock
+            m = map_file();
+        }
+        return m->size >= size ? m : mapping_ptr();
+    }
+
+private:
+    mapping_ptr
+    map_file() {
+        auto m  = std::make_shared<mapping>();
+        m->size = fc::file_size(path_);
+        if(m->size > 0) {
+            // empty file cannot be mapped
+            bip::file_mapping file(path_.generic_string().c_str(), bip::read_only);
+            m->region = bip::mapped_region(file, bip::read_only, 0, m->size);
+        }
+        auto r = mapping_ptr(std::move(m));
+        std::atomic_store(&mapping_, r);
+        return r;
+    }
+
+private:
+    fc::path    path_;
+    mapping_ptr mapping_;
+    std::mutex  remap_mutex_;
+};
+
+enum chunk_compression : uint32_t {
+    chunk_none = 0,
+    chunk_zlib = 1
+};
+
+// chunks are closed at whichever limit is reached first
+const uint32_t kMaxChunkBlocks  = 256;
+const uint32_t kMaxChunkRawSize = 4 * 1024 * 1024;
+
+// decoded chunks kept for readers, several readers going through different chunks each keep theirs
+const size_t kDecodedChunks = 8;
+
+/**
+ * Header of a chunk in version 2 block log. It's followed by the offsets of the blocks in raw payload,
+ * the payload (compressed or not) and the position of the chunk itself.
+ */
+struct chunk_header {
+    uint32_t first_block_num = 0;
+    uint32_t blocks          = 0;
+    uint32_t compression     = chunk_none;
+    uint32_t packed_size     = 0;
+    uint32_t raw_size        = 0;
+
+    uint64_t offsets_size() const { return sizeof(uint32_t) * blocks; }
+    uint32_t last_block_num() const { return first_block_num + blocks - 1; }
+
+    // size of the chunk without its trailing position
+    uint64_t size() const { return sizeof(chunk_header) + offsets_size() + packed_size; }
+};
+static_assert(sizeof(chunk_header) == 20, "chunk header should not have paddings");
+
+bytes
+zlib_compress(const char* data, size_t size) {
+    auto out = bytes();
+    bio::filtering_ostream comp;
+    comp.push(bio::zlib_compressor(bio::zlib::default_compression));
+    comp.push(bio::back_inserter(out));
+    bio::write(comp, data, size);
+    bio::close(comp);
+    return out;
+}
+
+void
+zlib_decompress(const char* data, size_t size, bytes& out) {
+    bio::filtering_ostream decomp;
+    decomp.push(bio::zlib_decompressor());
+    decomp.push(bio::back_inserter(out));
+    bio::write(decomp, data, size);
+    bio::close(decomp);
+}
+
+/**
+ * Writes blocks packed in `raw` as one chunk, `offsets` are the offsets of the blocks in `raw`.
+ * Payload is compressed unless it doesn't get smaller. Returns the position of the chunk.
+ * All the blocks of the chunk are indexed by the chunk position if `index_stream` is provided.
+ */
+uint64_t
+write_chunk(std::fstream& block_stream, std::fstream* index_stream, uint32_t first_block_num,
+            const std::vector<uint32_t>& offsets, const bytes& raw) {
+    auto header            = chunk_header();
+    header.first_block_num = first_block_num;
+    header.blocks          = offsets.size();
+    header.raw_size        = raw.size();
+
+    auto packed = zlib_compress(raw.data(), raw.size());
+    auto data   = raw.data();
+    auto size   = raw.size();
+    if(packed.size() < raw.size()) {
+        header.compression = chunk_zlib;
+        data               = packed.data();
+        size               = packed.size();
+    }
+    header.packed_size = size;
+
+    uint64_t pos = block_stream.tellp();
+    block_stream.write((char*)&header, sizeof(header));
+    block_stream.write((char*)offsets.data(), header.offsets_size());
+    block_stream.write(data, size);
+    block_stream.write((char*)&pos, sizeof(pos));
+
+    if(index_stream) {
+        for(auto i = 0u; i < header.blocks; i++) {
+            index_stream->write((char*)&pos, sizeof(pos));
+        }
+    }
+    return pos;
+}
+
+chunk_header
+read_chunk_header(const mapped_log_file::mapping& m, uint64_t pos) {
+    auto header = chunk_header();
+    vros_ASSERT(pos + sizeof(header) <= m.size, block_log_exception, "Chunk header is beyond the end of block log", ("pos", pos));
+    memcpy(&header, m.data() + pos, sizeof(header));
+    vros_ASSERT(header.blocks > 0 && pos + header.size() + sizeof(uint64_t) <= m.size, block_log_exception,
+              "Chunk is beyond the end of block log", ("pos", pos)("blocks", header.blocks)("packed_size", header.packed_size));
+    return header;
+}
+
+/**
+ * Chunk of version 2 block log with its payload decompressed.
+ */
+struct decoded_chunk {
+    uint64_t                        pos;
+    chunk_header                    header;
+    std::vector<uint32_t>           offsets;
+    const char*                     data = nullptr;  ///< raw payload
+    bytes                           buffer;          ///< owns raw payload if it was compressed
+    mapped_log_file::mapping_ptr    map;             ///< keeps raw payload mapped if it wasn't compressed
+
+    signed_block_ptr
+    read_block(uint32_t block_num) const {
+        vros_ASSERT(block_num >= header.first_block_num && block_num <= header.last_block_num(), block_log_exception,
+                  "Block is not in the chunk", ("block_num", block_num)("first", header.first_block_num)("last", header.last_block_num()));
+
+        auto i     = block_num - header.first_block_num;
+        auto begin = offsets[i];
+        auto end   = (i + 1 < header.blocks) ? offsets[i + 1] : header.raw_size;
+
+        auto ds = fc::datastream<const char*>(data + begin, end - begin);
+        auto b  = std::make_shared<signed_block>();
+        fc::raw::unpack(ds, *b);
+        return b;
+    }
+};
+using decoded_chunk_ptr = std::shared_ptr<const decoded_chunk>;
+
+decoded_chunk_ptr
+decode_chunk(const mapped_log_file::mapping_ptr& m, uint64_t pos) {
+    auto c    = std::make_shared<decoded_chunk>();
+    c->pos    = pos;
+    c->header = read_chunk_header(*m, pos);
+
+    auto p = m->data() + pos + sizeof(chunk_header);
+    c->offsets.resize(c->header.blocks);
+    memcpy(c->offsets.data(), p, c->header.offsets_size());
+    p += c->header.offsets_size();
+
+    switch(c->header.compression) {
+    case chunk_none: {
+        vros_ASSERT(c->header.packed_size == c->header.raw_size, block_log_exception, "Sizes of uncompressed chunk don't match", ("pos", pos));
+        c->data = p;
+        c->map  = m;
+        break;
+    }
+    case chunk_zlib: {
+        c->buffer.reserve(c->header.raw_size);
+        zlib_decompress(p, c->header.packed_size, c->buffer);
+        vros_ASSERT(c->buffer.size() == c->header.raw_size, block_log_exception, "Decompressed size of chunk doesn't match", ("pos", pos));
+        c->data = c->buffer.data();
+        break;
+    }
+    default: {
+        vros_THROW(block_log_exception, "Unknown compression of chunk", ("pos", pos)("compression", c->header.compression));
+    }
+    }  // switch
+
+    for(auto i = 0u; i < c->header.blocks; i++) {
+        vros_ASSERT(c->offsets[i] < c->header.raw_size && (i == 0 || c->offsets[i] > c->offsets[i - 1]), block_log_exception,
+                  "Invalid block offsets in chunk", ("pos", pos));
+    }
+    return c;
+}
+
+/**
+ * Reads blocks.pending, returns the blocks following `log_num` with their packed data. Reading stops at
+ * a torn record or a block which doesn't follow the previous one.
+ */
+std::vector<std::pair<signed_block_ptr, bytes>>
+read_pending_blocks(const fc::path& file, uint32_t log_num) {
+    auto blocks = std::vector<std::pair<signed_block_ptr, bytes>>();
+    if(!fc::exists(file)) {
+        return blocks;
+    }
+
+    auto content = std::string();
+    fc::read_file_contents(file, content);
+
+    auto ds = fc::datastream<const char*>(content.data(), content.size());
+    while(ds.remaining() >= sizeof(uint32_t)) {
+        uint32_t size = 0;
+        ds.read((char*)&size, sizeof(size));
+        if(ds.remaining() < size) {
+            break;
+        }
+        auto data = bytes(ds.pos(), ds.pos() + size);
+        ds.skip(size);
+
+        auto b   = std::make_shared<signed_block>();
+        auto bds = fc::datastream<const char*>(data.data(), data.size());
+        fc::raw::unpack(bds, *b);
+        if(b->block_num() <= log_num) {
+            continue;
+        }
+        if(b->block_num() != log_num + blocks.size() + 1) {
+            break;
+        }
+        blocks.emplace_back(b, std::move(data));
+    }
+    return blocks;
+}
+
+/**
+ * Chunk of version 2 block log being filled by appended blocks. Its blocks are kept in memory and
+ * in blocks.pending until the chunk is full, then it's written into blocks.log as a whole.
+ */
+struct pending_chunk {
+    uint32_t                      first_block_num = 0;
+    std::vector<uint32_t>         offsets;
+    bytes                         raw;
+    std::vector<signed_block_ptr> blocks;
+
+    bool empty() const { return blocks.empty(); }
+    bool full() const { return blocks.size() >= kMaxChunkBlocks || raw.size() >= kMaxChunkRawSize; }
+    uint32_t last_block_num() const { return first_block_num + blocks.size() - 1; }
+
+    void
+    add(const signed_block_ptr& b, const bytes& data) {
+        if(blocks.empty()) {
+            first_block_num = b->block_num();
+        }
+        offsets.emplace_back(raw.size());
+        raw.insert(raw.end(), data.cbegin(), data.cend());
+        blocks.emplace_back(b);
+    }
+
+    signed_block_ptr
+    get(uint32_t block_num) const {
+        if(blocks.empty() || block_num < first_block_num || block_num > last_block_num()) {
+            return signed_block_ptr();
+        }
+        return blocks[block_num - first_block_num];
+    }
+
+    void
+    clear() {
+        offsets.clear();
+        raw.clear();
+        blocks.clear();
+    }
+};
+
+// moves blocks directory to a backup location and recreates it empty, returns the backup directory
+fc::path
+backup_blocks_dir(const fc::path& data_dir, const fc::time_point& now, fc::path& blocks_dir) {
+    vros_ASSERT(fc::is_directory(data_dir) && fc::is_regular_file(data_dir / "blocks.log"), block_log_not_found,
+              "Block log not found in '${blocks_dir}'", ("blocks_dir", data_dir));
+
+    blocks_dir = fc::canonical(data_dir);
+    if(blocks_dir.filename().generic_string() == ".") {
+        blocks_dir = blocks_dir.parent_path();
+    }
+    auto backup_dir      = blocks_dir.parent_path();
+    auto blocks_dir_name = blocks_dir.filename();
+    vros_ASSERT(blocks_dir_name.generic_string() != ".", block_log_exception, "Invalid path to blocks directory");
+    backup_dir = backup_dir / blocks_dir_name.generic_string().append("-").append(now);
+
+    vros_ASSERT(!fc::exists(backup_dir), block_log_backup_dir_exist,
+              "Cannot move existing blocks directory to already existing directory '${new_blocks_dir}'",
+              ("new_blocks_dir", backup_dir));
+
+    fc::rename(blocks_dir, backup_dir);
+    ilog("Moved existing blocks directory to backup location: '${new_blocks_dir}'", ("new_blocks_dir", backup_dir));
+
+    fc::create_directories(blocks_dir);
+    return backup_dir;
+}
+
+void
+check_version(uint32_t version) {
+    vros_ASSERT(version > 0, block_log_exception, "Block log was not setup properly with genesis information.");
+    vros_ASSERT(version >= block_log::min_supported_version && version <= block_log::supported_version, block_log_unsupported_version,
+              "Unsupported version of block log. Block log version is ${version} while code supports version ${min} to ${supported}",
+              ("version", version)("min", block_log::min_supported_version)("supported", block_log::supported_version));
+}
+
+// position right after version and genesis state, where the first block or chunk starts
+uint64_t
+genesis_end(const mapped_log_file::mapping& m) {
+    auto ds = fc::datastream<const char*>(m.data(), m.size);
+    ds.skip(sizeof(uint32_t));
+
+    genesis_state gs;
+    fc::raw::unpack(ds, gs);
+    return ds.tellp();
+}
+
+/**
+ * Buffers index entries and writes them out in large blocks.
+ */
+class index_writer {
+public:
+    static const size_t kBatchSize = 64 * 1024;
+
+public:
+    index_writer(std::fstream& index_stream)
+        : index_stream_(index_stream) {
+        batch_.reserve(kBatchSize);
+    }
+
+    void
+    add(uint64_t pos) {
+        batch_.emplace_back(pos);
+        if(batch_.size() == kBatchSize) {
+            flush();
+        }
+    }
+
+    void
+    flush() {
+        index_stream_.write((char*)batch_.data(), batch_.size() * sizeof(uint64_t));
+        batch_.clear();
+    }
+
+private:
+    std::fstream&         index_stream_;
+    std::vector<uint64_t> batch_;
+};
+
+/**
+ * Reconstructs the index of version 1 block log without decoding any block.
+ *
+ * Each block is followed by its own position, so walking from the trailer at the end, the 8 bytes before
+ * a block tell where the previous block starts. Positions are found backwards and written in batches at
+ * their places in the index file. Returns false if the back pointers don't lead to the first block in
+ * exactly `blocks` steps, caller should scan the blocks instead then.
+ */
+bool
+construct_index_backward(const mapped_log_file::mapping& m, uint64_t first_pos, uint64_t end_pos, uint32_t blocks, const fc::path& index_file) {
+    if(blocks == 0) {
+        return false;
+    }
+
+    std::fstream index_stream;
+    index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+    index_stream.open(index_file.generic_string().c_str(), std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+
+    auto batch = std::vector<uint64_t>(std::min<size_t>(blocks, index_writer::kBatchSize));
+    auto pos   = end_pos;
+    auto i     = blocks;  // number of positions left to find, including `pos`
+    while(i > 0) {
+        auto n = std::min<size_t>(i, batch.size());
+        for(auto j = n; j > 0; j--) {
+            batch[j - 1] = pos;
+            i--;
+            if(i == 0) {
+                break;
+            }
+            if(pos < first_pos + sizeof(uint64_t)) {
+                return false;
+            }
+            auto prev = m.read_u64(pos - sizeof(uint64_t));
+            if(prev >= pos || prev < first_pos) {
+                return false;
+            }
+            pos = prev;
+        }
+        index_stream.seekp(sizeof(uint64_t) * i);
+        index_stream.write((char*)batch.data(), sizeof(uint64_t) * n);
+    }
+    index_stream.flush();
+    return pos == first_pos;
+}
+
 class block_log_impl {
 public:
-    signed_block_ptr head;
-    block_id_type    head_id;
-    std::fstream     block_stream;
-    std::fstream     index_stream;
-    fc::path         block_file;
-    fc::path         index_file;
-    bool             block_write;
-    bool             index_write;
-    bool             genesis_written_to_block_log = false;
-
-    inline void
-    check_block_read() {
-        if(block_write) {
+    signed_block_ptr      head;
+    block_id_type         head_id;
+    std::atomic<uint32_t> head_num {0};  ///< number of head block, readable from any thread
+    std::atomic<uint64_t> head_end {0};  ///< size of blocks.log once head block is written, set before `head_num`
+    std::atomic<uint32_t> log_num {0};   ///< number of last block in blocks.log, later ones are in pending chunk
+    std::fstream          block_stream;  ///< append-only writer of blocks.log
+    std::fstream          index_stream;  ///< append-only writer of blocks.index
+    std::fstream          pending_stream;  ///< writer of blocks.pending, version 2 only
+    mapped_log_file       block_map;     ///< reader of blocks.log
+    mapped_log_file       index_map;     ///< reader of blocks.index
+    fc::path              block_file;
+    fc::path              index_file;
+    fc::path              pending_file;
+    bool                  genesis_written_to_block_log = false;
+    uint32_t              version = 0;
+
+    uint32_t              retain_blocks = 0;  ///< number of most recent blocks kept, zero to keep all
+    std::atomic<uint32_t> first_num {1};      ///< number of first block in the log, blocks before it are pruned
+    uint64_t              first_pos = 0;      ///< position of first block or chunk
+    std::shared_timed_mutex prune_mutex;      ///< held exclusively while pruned files replace current ones
+
+    std::thread           prune_thread;          ///< copies retained chunks into pruned files
+    std::atomic<bool>     prune_done {false};    ///< copying by `prune_thread` is done, files can be swapped
+    bool                  prune_failed = false;
+    uint64_t              prune_end    = 0;      ///< end of blocks.log copied by `prune_thread`
+    uint32_t              prune_first  = 0;      ///< number of first block in pruned files
+    std::fstream          prune_block_stream;
+    std::fstream          prune_index_stream;
+    fc::path              prune_block_file;
+    fc::path              prune_index_file;
+
+    std::mutex        chunk_mutex;
+    std::deque<decoded_chunk_ptr> recent_chunks;  ///< most recently read chunks first, sequential reads mostly hit them
+    pending_chunk     pending;     ///< blocks after `log_num`, modified by writer under `chunk_mutex`
+
+    void
+    open_writers() {
+        block_stream.open(block_file.generic_string().c_str(), LOG_WRITE);
+        index_stream.open(index_file.generic_string().c_str(), LOG_WRITE);
+    }
+
+    ~block_log_impl() {
+        stop_prune();
+    }
+
+    void
+    close_all() {
+        stop_prune();
+        if(block_stream.is_open())
             block_stream.close();
-            block_stream.open(block_file.generic_string().c_str(), LOG_READ);
-            block_write = false;
+        if(index_stream.is_open())
+            index_stream.close();
+        if(pending_stream.is_open())
+            pending_stream.close();
+        block_map.close();
+        index_map.close();
+        head_num  = 0;
+        head_end  = 0;
+        log_num   = 0;
+        first_num = 1;
+
+        std::lock_guard<std::mutex> lock(chunk_mutex);
+        recent_chunks.clear();
+        pending.clear();
+    }
+
+    /**
+     * `end` is the size of blocks.log with `b` written, readers rely on it once they see the new head number.
+     * `in_log` tells if `b` is written into blocks.log, otherwise it's in pending chunk.
+     */
+    void
+    set_head(const signed_block_ptr& b, uint64_t end, bool in_log = true) {
+        head     = b;
+        head_id  = b ? b->id() : block_id_type();
+        head_end = end;
+        if(in_log) {
+            log_num = b ? b->block_num() : 0;
         }
+        head_num = b ? b->block_num() : 0;
     }
 
-    inline void
-    check_block_write() {
-        if(!block_write) {
-            block_stream.close();
-            block_stream.open(block_file.generic_string().c_str(), LOG_WRITE);
-            block_write = true;
+    void
+    append_pending(const signed_block_ptr& b, const bytes& data) {
+        uint32_t size = data.size();
+        pending_stream.write((char*)&size, sizeof(size));
+        pending_stream.write(data.data(), data.size());
+
+        std::lock_guard<std::mutex> lock(chunk_mutex);
+        pending.add(b, data);
+    }
+
+    /**
+     * Loads blocks of pending chunk from blocks.pending, and writes the file again with only the blocks
+     * following blocks.log. Blocks already written into blocks.log and a torn record at the end are dropped.
+     */
+    void
+    load_pending() {
+        auto blocks = read_pending_blocks(pending_file, log_num);
+
+        pending_stream.open(pending_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        for(auto& b : blocks) {
+            append_pending(b.first, b.second);
+        }
+        pending_stream.flush();
+        if(!blocks.empty()) {
+            set_head(blocks.back().first, head_end, false);
         }
     }
 
-    inline void
-    check_index_read() {
-        try {
-            if(index_write) {
-                index_stream.close();
-                index_stream.open(index_file.generic_string().c_str(), LOG_READ);
-                index_write = false;
+    // writes pending chunk into blocks.log and starts an empty one
+    void
+    close_chunk() {
+        vros_ASSERT((size_t)index_stream.tellp() == sizeof(uint64_t) * (pending.first_block_num - first_num),
+                  block_log_append_fail,
+                  "Append to index file occuring at wrong position.",
+                  ("position", (uint64_t)index_stream.tellp())("expected", (pending.first_block_num - first_num) * sizeof(uint64_t)));
+
+        write_chunk(block_stream, &index_stream, pending.first_block_num, pending.offsets, pending.raw);
+        block_stream.flush();
+        index_stream.flush();
+        log_num = pending.last_block_num();
+
+        {
+            std::lock_guard<std::mutex> lock(chunk_mutex);
+            pending.clear();
+        }
+        pending_stream.close();
+        pending_stream.open(pending_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    }
+
+    // reads block after blocks.log, it may have been written into blocks.log meanwhile
+    signed_block_ptr
+    read_pending_block(uint32_t block_num) {
+        {
+            std::lock_guard<std::mutex> lock(chunk_mutex);
+            if(auto b = pending.get(block_num)) {
+                return b;
             }
         }
-        FC_LOG_AND_RETHROW()
+        auto pos = get_block_pos(block_num);
+        return pos != block_log::npos ? read_chunk(pos)->read_block(block_num) : signed_block_ptr();
+    }
+
+    // position of the last block stored in the trailer of the file, `size` is set to the size of the file
+    uint64_t
+    read_tail_pos(mapped_log_file& file, uint64_t* size = nullptr) {
+        auto m = file.remap();
+        if(size) {
+            *size = m->size;
+        }
+        if(m->size < sizeof(uint64_t)) {
+            return block_log::npos;
+        }
+        return m->read_u64(m->size - sizeof(uint64_t));
     }
 
-    inline void
-    check_index_write() {
-        if(!index_write) {
+    uint64_t
+    get_block_pos(uint32_t block_num) {
+        if(!(block_num <= log_num && block_num >= first_num))
+            return block_log::npos;
+
+        auto end = sizeof(uint64_t) * (block_num - first_num + 1);
+        auto m   = index_map.ensure(end);
+        vros_ASSERT(m, block_log_exception, "Block index is shorter than block log", ("block_num", block_num));
+        return m->read_u64(end - sizeof(uint64_t));
+    }
+
+    // end of the block (including its trailing position) in version 1 block log
+    uint64_t
+    get_block_end(uint32_t block_num) {
+        // log number is read before next position, so `head_end` already covers the block when it's the head
+        auto end  = head_end.load();
+        auto next = get_block_pos(block_num + 1);
+        return next != block_log::npos ? next : end;
+    }
+
+    bool
+    need_prune() const {
+        // prunes in batches so the amortized cost of copying retained blocks stays low
+        return retain_blocks > 0 && head_num - first_num + 1 >= retain_blocks + std::max(retain_blocks / 4, 1u);
+    }
+
+    /**
+     * Copies chunks in [pos, end) of the mapping to the end of the pruned files, returns the number of
+     * first block copied or zero if there is no chunk.
+     */
+    uint32_t
+    copy_chunks(const mapped_log_file::mapping& m, uint64_t pos, uint64_t end) {
+        auto first = 0u;
+        while(pos < end) {
+            auto header = read_chunk_header(m, pos);
+            if(first == 0) {
+                first = header.first_block_num;
+            }
+
+            uint64_t new_pos = prune_block_stream.tellp();
+            prune_block_stream.write(m.data() + pos, header.size());
+            prune_block_stream.write((char*)&new_pos, sizeof(new_pos));
+            for(auto i = 0u; i < header.blocks; i++) {
+                prune_index_stream.write((char*)&new_pos, sizeof(new_pos));
+            }
+            pos += header.size() + sizeof(uint64_t);
+        }
+        return first;
+    }
+
+    void
+    maybe_prune() {
+        if(prune_done) {
+            finish_prune();
+        }
+        else if(!prune_thread.joinable() && need_prune()) {
+            start_prune();
+        }
+    }
+
+    /**
+     * Starts removing the blocks older than the retained ones. Chunks holding retained blocks are copied
+     * into new files by a background thread, so the first chunk kept may also hold a few older blocks.
+     * The writer keeps appending meanwhile, `finish_prune` copies the chunks appended since then.
+     */
+    void
+    start_prune() {
+        // last chunk is kept even if all its blocks are older than retained ones
+        auto keep_from = std::min<uint32_t>(head_num - retain_blocks + 1, log_num);
+        if(keep_from < first_num) {
+            return;
+        }
+        auto pos = get_block_pos(keep_from);
+        auto m   = block_map.remap();
+
+        fc::remove_all(prune_block_file);
+        fc::remove_all(prune_index_file);
+        prune_block_stream.open(prune_block_file.generic_string().c_str(), LOG_WRITE);
+        prune_index_stream.open(prune_index_file.generic_string().c_str(), LOG_WRITE);
+
+        prune_end    = m->size;
+        prune_failed = false;
+        prune_thread = std::thread([this, pos, m]() {
+            try {
+                // version and genesis are kept
+                prune_block_stream.write(m->data(), first_pos);
+                prune_first = copy_chunks(*m, pos, m->size);
+            }
+            catch(const fc::exception& e) {
+                elog("Failed to prune block log: ${e}", ("e", e.to_detail_string()));
+                prune_failed = true;
+            }
+            catch(const std::exception& e) {
+                elog("Failed to prune block log: ${e}", ("e", e.what()));
+                prune_failed = true;
+            }
+            prune_done = true;
+        });
+    }
+
+    // swaps pruned files in once the background copy is done, readers are only blocked for the swap
+    void
+    finish_prune() {
+        prune_thread.join();
+        prune_done = false;
+
+        try {
+            vros_ASSERT(!prune_failed, block_log_exception, "Copying retained blocks failed");
+
+            // chunks appended while copying, only a few of them
+            auto m     = block_map.remap();
+            auto first = copy_chunks(*m, prune_end, m->size);
+            if(prune_first == 0) {
+                prune_first = first;
+            }
+            prune_block_stream.close();
+            prune_index_stream.close();
+
+            std::unique_lock<std::shared_timed_mutex> lock(prune_mutex);
+
+            block_stream.close();
             index_stream.close();
-            index_stream.open(index_file.generic_string().c_str(), LOG_WRITE);
-            index_write = true;
+            fc::rename(prune_block_file, block_file);
+            fc::rename(prune_index_file, index_file);
+            block_map.close();
+            index_map.close();
+            open_writers();
+            first_num = prune_first;
+
+            std::lock_guard<std::mutex> chunk_lock(chunk_mutex);
+            recent_chunks.clear();
+        }
+        catch(...) {
+            stop_prune();
+            throw;
         }
+        ilog("Pruned block log, it starts from block ${n} now", ("n", prune_first));
+    }
+
+    // abandons the prune in progress, current files are kept
+    void
+    stop_prune() {
+        if(prune_thread.joinable()) {
+            prune_thread.join();
+        }
+        prune_done = false;
+        if(prune_block_stream.is_open())
+            prune_block_stream.close();
+        if(prune_index_stream.is_open())
+            prune_index_stream.close();
+        if(!prune_block_file.empty()) {
+            fc::remove_all(prune_block_file);
+            fc::remove_all(prune_index_file);
+        }
+    }
+
+    decoded_chunk_ptr
+    read_chunk(uint64_t pos) {
+        {
+            std::lock_guard<std::mutex> lock(chunk_mutex);
+            auto it = std::find_if(recent_chunks.begin(), recent_chunks.end(), [pos](auto& c) { return c->pos == pos; });
+            if(it != recent_chunks.end()) {
+                auto c = *it;
+                recent_chunks.erase(it);
+                recent_chunks.emplace_front(c);
+                return c;
+            }
+        }
+
+        auto m = block_map.ensure(pos + sizeof(chunk_header));
+        vros_ASSERT(m, block_log_exception, "Chunk position is beyond the end of block log", ("pos", pos));
+        auto header = chunk_header();
+        memcpy(&header, m->data() + pos, sizeof(header));
+        m = block_map.ensure(pos + header.size() + sizeof(uint64_t));
+        vros_ASSERT(m, block_log_exception, "Chunk is beyond the end of block log", ("pos", pos));
+
+        auto c = decode_chunk(m, pos);
+
+        // another reader may have decoded the same chunk meanwhile, keeping both is harmless
+        std::lock_guard<std::mutex> lock(chunk_mutex);
+        recent_chunks.emplace_front(c);
+        if(recent_chunks.size() > kDecodedChunks) {
+            recent_chunks.pop_back();
+        }
+        return c;
+    }
+
+    /**
+     * Reads the block at `pos` of version 1 block log, `end` is where the block and its trailing position end.
+     * Whole block is ensured to be mapped, mapping taken while it was partly written is never used for it.
+     * Returns the block and the position of next one.
+     */
+    std::pair<signed_block_ptr, uint64_t>
+    read_block(uint64_t pos, uint64_t end) {
+        vros_ASSERT(end > pos + sizeof(uint64_t), block_log_exception, "Invalid end of block", ("pos", pos)("end", end));
+        auto m = block_map.ensure(end);
+        vros_ASSERT(m, block_log_exception, "Block position is beyond the end of block log", ("pos", pos));
+
+        auto ds = fc::datastream<const char*>(m->data() + pos, end - sizeof(uint64_t) - pos);
+
+        auto result  = std::pair<signed_block_ptr, uint64_t>();
+        result.first = std::make_shared<signed_block>();
+        fc::raw::unpack(ds, *result.first);
+        result.second = pos + ds.tellp() + sizeof(uint64_t);
+        return result;
     }
 };
+
 }  // namespace detail
 
-block_log::block_log(const fc::path& data_dir)
+block_log::block_log(const fc::path& data_dir, uint32_t retain_blocks)
     : my(new detail::block_log_impl()) {
     my->block_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
     my->index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+    my->pending_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+    my->prune_block_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+    my->prune_index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+    my->retain_blocks = retain_blocks;
     open(data_dir);
 }
 
@@ -88,21 +869,21 @@ block_log::~block_log() {
 
 void
 block_log::open(const fc::path& data_dir) {
-    if(my->block_stream.is_open())
-        my->block_stream.close();
-    if(my->index_stream.is_open())
-        my->index_stream.close();
+    my->close_all();
 
     if(!fc::is_directory(data_dir))
         fc::create_directories(data_dir);
-    my->block_file = data_dir / "blocks.log";
-    my->index_file = data_dir / "blocks.index";
+    my->block_file   = data_dir / "blocks.log";
+    my->index_file   = data_dir / "blocks.index";
+    my->pending_file = data_dir / "blocks.pending";
+
+    my->prune_block_file = fc::path(my->block_file.generic_string() + ".prune");
+    my->prune_index_file = fc::path(my->index_file.generic_string() + ".prune");
 
     //ilog("Opening block log at ${path}", ("path", my->block_file.generic_string()));
-    my->block_stream.open(my->block_file.generic_string().c_str(), LOG_WRITE);
-    my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-    my->block_write = true;
-    my->index_write = true;
+    my->open_writers();
+    my->block_map.open(my->block_file);
+    my->index_map.open(my->index_file);
 
     /* On startup of the block log, there are several states the log file and the index file can be
        * in relation to each other.
@@ -127,31 +908,30 @@ block_log::open(const fc::path& data_dir) {
 
     if(log_size) {
         ilog("Log is nonempty");
-        my->check_block_read();
-        my->block_stream.seekg(0);
+        auto m = my->block_map.remap();
         uint32_t version = 0;
-        my->block_stream.read((char*)&version, sizeof(version));
-        vros_ASSERT(version > 0, block_log_exception, "Block log was not setup properly with genesis information.");
-        vros_ASSERT(version == block_log::supported_version, block_log_unsupported_version,
-                  "Unsupported version of block log. Block log version is ${version} while code supports version ${supported}",
-                  ("version", version)("supported", block_log::supported_version));
+        if(m->size >= sizeof(version)) {
+            memcpy(&version, m->data(), sizeof(version));
+        }
+        detail::check_version(version);
 
+        // old logs are kept in their version, blocks appended to them are in the same format
+        my->version                      = version;
         my->genesis_written_to_block_log = true;  // Assume it was constructed properly.
-        my->head                         = read_head();
-        my->head_id                      = my->head->id();
+        my->first_pos                    = detail::genesis_end(*m);
+        my->set_head(read_head(), m->size);
 
-        if(index_size) {
-            my->check_block_read();
-            my->check_index_read();
+        // pruned log starts from a later chunk, only its header is read
+        if(version > 1 && m->size > my->first_pos) {
+            my->first_num = detail::read_chunk_header(*m, my->first_pos).first_block_num;
+        }
+        vros_ASSERT(my->retain_blocks == 0 || version > 1, block_log_exception,
+                  "Block log of version ${v} cannot be pruned, convert it first", ("v", version));
 
+        if(index_size) {
             ilog("Index is nonempty");
-            uint64_t block_pos;
-            my->block_stream.seekg(-sizeof(uint64_t), std::ios::end);
-            my->block_stream.read((char*)&block_pos, sizeof(block_pos));
-
-            uint64_t index_pos;
-            my->index_stream.seekg(-sizeof(uint64_t), std::ios::end);
-            my->index_stream.read((char*)&index_pos, sizeof(index_pos));
+            auto block_pos = my->read_tail_pos(my->block_map);
+            auto index_pos = my->read_tail_pos(my->index_map);
 
             if(block_pos < index_pos) {
                 ilog("block_pos < index_pos, close and reopen index_stream");
@@ -166,13 +946,17 @@ block_log::open(const fc::path& data_dir) {
             ilog("Index is empty");
             construct_index();
         }
+
+        if(version > 1) {
+            my->load_pending();
+        }
     }
     else if(index_size) {
         ilog("Index is nonempty, remove and recreate it");
         my->index_stream.close();
+        my->index_map.close();
         fc::remove_all(my->index_file);
         my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-        my->index_write = true;
     }
 }
 
@@ -181,22 +965,38 @@ block_log::append(const signed_block_ptr& b) {
     try {
         vros_ASSERT(my->genesis_written_to_block_log, block_log_append_fail, "Cannot append to block log until the genesis is first written");
 
-        my->check_block_write();
-        my->check_index_write();
+        // position of the block, or of the chunk which is going to hold it since version 2
+        uint64_t pos  = my->block_stream.tellp();
+        auto     data = fc::raw::pack(*b);
+        if(my->version == 1) {
+            vros_ASSERT((size_t)my->index_stream.tellp() == sizeof(uint64_t) * (b->block_num() - my->first_num),
+                      block_log_append_fail,
+                      "Append to index file occuring at wrong position.",
+                      ("position", (uint64_t)my->index_stream.tellp())("expected", (b->block_num() - my->first_num) * sizeof(uint64_t)));
+
+            my->block_stream.write(data.data(), data.size());
+            my->block_stream.write((char*)&pos, sizeof(pos));
+            my->index_stream.write((char*)&pos, sizeof(pos));
+
+            flush();
+            // block becomes visible to readers only after it's written out
+            my->set_head(b, my->block_stream.tellp());
+        }
+        else {
+            vros_ASSERT(b->block_num() == my->head_num + 1, block_log_append_fail, "Appended block doesn't follow head block",
+                      ("block_num", b->block_num())("head_num", my->head_num.load()));
 
-        uint64_t pos = my->block_stream.tellp();
-        vros_ASSERT((size_t)my->index_stream.tellp() == sizeof(uint64_t) * (b->block_num() - 1),
-                  block_log_append_fail,
-                  "Append to index file occuring at wrong position.",
-                  ("position", (uint64_t)my->index_stream.tellp())("expected", (b->block_num() - 1) * sizeof(uint64_t)));
-        auto data = fc::raw::pack(*b);
-        my->block_stream.write(data.data(), data.size());
-        my->block_stream.write((char*)&pos, sizeof(pos));
-        my->index_stream.write((char*)&pos, sizeof(pos));
-        my->head    = b;
-        my->head_id = b->id();
+            // block is kept in pending chunk until the chunk is full
+            my->append_pending(b, data);
+            flush();
+            my->set_head(b, my->head_end, false);
 
-        flush();
+            if(my->pending.full()) {
+                my->close_chunk();
+            }
+        }
+
+        my->maybe_prune();
 
         return pos;
     }
@@ -207,28 +1007,29 @@ void
 block_log::flush() {
     my->block_stream.flush();
     my->index_stream.flush();
+    if(my->pending_stream.is_open()) {
+        my->pending_stream.flush();
+    }
 }
 
 uint64_t
 block_log::reset_to_genesis(const genesis_state& gs, const signed_block_ptr& genesis_block) {
-    if(my->block_stream.is_open())
-        my->block_stream.close();
-    if(my->index_stream.is_open())
-        my->index_stream.close();
+    my->close_all();
 
     fc::remove_all(my->block_file);
     fc::remove_all(my->index_file);
+    fc::remove_all(my->pending_file);
 
-    my->block_stream.open(my->block_file.generic_string().c_str(), LOG_WRITE);
-    my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-    my->block_write = true;
-    my->index_write = true;
+    my->open_writers();
+    my->pending_stream.open(my->pending_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
 
     auto     data    = fc::raw::pack(gs);
     uint32_t version = 0;  // version of 0 is invalid; it indicates that the genesis was not properly written to the block log
     my->block_stream.write((char*)&version, sizeof(version));
     my->block_stream.write(data.data(), data.size());
     my->genesis_written_to_block_log = true;
+    my->version                      = block_log::supported_version;
+    my->first_pos                    = sizeof(version) + data.size();
 
     auto ret = append(genesis_block);
 
@@ -244,31 +1045,31 @@ block_log::reset_to_genesis(const genesis_state& gs, const signed_block_ptr& gen
     my->block_stream.seekp(pos);
     flush();
 
-    my->block_write = false;
-    my->check_block_write();  // Reset to append-only writing.
+    my->block_stream.close();
+    my->block_stream.open(my->block_file.generic_string().c_str(), LOG_WRITE);  // Reset to append-only writing.
 
     return ret;
 }
 
-std::pair<signed_block_ptr, uint64_t>
-block_log::read_block(uint64_t pos) const {
-    my->check_block_read();
-
-    my->block_stream.seekg(pos);
-    std::pair<signed_block_ptr, uint64_t> result;
-    result.first = std::make_shared<signed_block>();
-    fc::raw::unpack(my->block_stream, *result.first);
-    result.second = uint64_t(my->block_stream.tellg()) + 8;
-    return result;
-}
-
 signed_block_ptr
 block_log::read_block_by_num(uint32_t block_num) const {
     try {
+        std::shared_lock<std::shared_timed_mutex> lock(my->prune_mutex);
+
         signed_block_ptr b;
-        uint64_t         pos = get_block_pos(block_num);
+        uint64_t         pos = my->get_block_pos(block_num);
         if(pos != npos) {
-            b = read_block(pos).first;
+            if(my->version == 1) {
+                b = my->read_block(pos, my->get_block_end(block_num)).first;
+            }
+            else {
+                b = my->read_chunk(pos)->read_block(block_num);
+            }
+        }
+        else if(my->version > 1 && block_num >= my->first_num) {
+            b = my->read_pending_block(block_num);
+        }
+        if(b) {
             vros_ASSERT(b->block_num() == block_num, reversible_blocks_exception,
                       "Wrong block was read from block log.", ("returned", b->block_num())("expected", block_num));
         }
@@ -279,30 +1080,41 @@ block_log::read_block_by_num(uint32_t block_num) const {
 
 uint64_t
 block_log::get_block_pos(uint32_t block_num) const {
-    my->check_index_read();
+    std::shared_lock<std::shared_timed_mutex> lock(my->prune_mutex);
+    return my->get_block_pos(block_num);
+}
 
-    if(!(my->head && block_num <= block_header::num_from_id(my->head_id) && block_num > 0))
-        return npos;
-    my->index_stream.seekg(sizeof(uint64_t) * (block_num - 1));
-    uint64_t pos;
-    my->index_stream.read((char*)&pos, sizeof(pos));
-    return pos;
+uint32_t
+block_log::first_block_num() const {
+    return my->first_num;
 }
 
 signed_block_ptr
 block_log::read_head() const {
-    my->check_block_read();
+    std::shared_lock<std::shared_timed_mutex> lock(my->prune_mutex);
 
-    uint64_t pos;
+    if(my->version > 1) {
+        std::lock_guard<std::mutex> lock(my->chunk_mutex);
+        if(!my->pending.empty()) {
+            return my->pending.blocks.back();
+        }
+    }
 
     // Check that the file is not empty
-    my->block_stream.seekg(0, std::ios::end);
-    if((size_t)my->block_stream.tellg() <= sizeof(pos))
+    auto size = uint64_t();
+    auto pos  = my->read_tail_pos(my->block_map, &size);
+    if(pos == npos)
         return {};
 
-    my->block_stream.seekg(-sizeof(pos), std::ios::end);
-    my->block_stream.read((char*)&pos, sizeof(pos));
-    return read_block(pos).first;
+    if(my->version == 1) {
+        return my->read_block(pos, size).first;
+    }
+    if(size <= my->first_pos) {
+        // no chunk is written yet, all blocks are in pending chunk
+        return {};
+    }
+    auto c = my->read_chunk(pos);
+    return c->read_block(c->header.last_block_num());
 }
 
 const signed_block_ptr&
@@ -314,55 +1126,64 @@ void
 block_log::construct_index() {
     ilog("Reconstructing Block Log Index...");
     my->index_stream.close();
+    my->index_map.close();
     fc::remove_all(my->index_file);
-    my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-    my->index_write = true;
 
-    uint64_t end_pos;
-    my->check_block_read();
+    auto m = my->block_map.remap();
+    if(my->version > 1 && m->size <= my->first_pos) {
+        // no chunk is written yet
+        my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
+        return;
+    }
+    uint64_t end_pos = m->read_u64(m->size - sizeof(uint64_t));
+
+    if(my->version == 1 && detail::construct_index_backward(*m, my->first_pos, end_pos, my->head_num, my->index_file)) {
+        my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
+        return;
+    }
 
-    my->block_stream.seekg(-sizeof(uint64_t), std::ios::end);
-    my->block_stream.read((char*)&end_pos, sizeof(end_pos));
-    signed_block tmp;
+    fc::remove_all(my->index_file);
+    my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
+    auto writer = detail::index_writer(my->index_stream);
 
-    uint64_t pos = 4;  // Skip version which should have already been checked.
-    my->block_stream.seekg(pos);
+    if(my->version == 1) {
+        ilog("Back pointers of block log are broken, scan blocks instead");
 
-    genesis_state gs;
-    fc::raw::unpack(my->block_stream, gs);
+        auto ds = fc::datastream<const char*>(m->data() + my->first_pos, m->size - my->first_pos);
+        signed_block tmp;
 
-    while(pos < end_pos) {
-        fc::raw::unpack(my->block_stream, tmp);
-        my->block_stream.read((char*)&pos, sizeof(pos));
-        my->index_stream.write((char*)&pos, sizeof(pos));
+        uint64_t pos = 0;
+        while(pos < end_pos) {
+            fc::raw::unpack(ds, tmp);
+            ds.read((char*)&pos, sizeof(pos));
+            writer.add(pos);
+        }
     }
+    else {
+        // only chunk headers are read, payloads are skipped
+        uint64_t pos = my->first_pos;
+        while(pos <= end_pos) {
+            auto header = detail::read_chunk_header(*m, pos);
+            vros_ASSERT(m->read_u64(pos + header.size()) == pos, block_log_exception,
+                      "Position of chunk doesn't match", ("pos", pos));
+            for(auto i = 0u; i < header.blocks; i++) {
+                writer.add(pos);
+            }
+            pos += header.size() + sizeof(uint64_t);
+        }
+    }
+    writer.flush();
+    my->index_stream.flush();
 }  // construct_index
 
 fc::path
 block_log::repair_log(const fc::path& data_dir, uint32_t truncate_at_block) {
     ilog("Recovering Block Log...");
-    vros_ASSERT(fc::is_directory(data_dir) && fc::is_regular_file(data_dir / "blocks.log"), block_log_not_found,
-              "Block log not found in '${blocks_dir}'", ("blocks_dir", data_dir));
-
-    auto now = fc::time_point::now();
 
-    auto blocks_dir = fc::canonical(data_dir);
-    if(blocks_dir.filename().generic_string() == ".") {
-        blocks_dir = blocks_dir.parent_path();
-    }
-    auto backup_dir      = blocks_dir.parent_path();
-    auto blocks_dir_name = blocks_dir.filename();
-    vros_ASSERT(blocks_dir_name.generic_string() != ".", block_log_exception, "Invalid path to blocks directory");
-    backup_dir = backup_dir / blocks_dir_name.generic_string().append("-").append(now);
-
-    vros_ASSERT(!fc::exists(backup_dir), block_log_backup_dir_exist,
-              "Cannot move existing blocks directory to already existing directory '${new_blocks_dir}'",
-              ("new_blocks_dir", backup_dir));
-
-    fc::rename(blocks_dir, backup_dir);
-    ilog("Moved existing blocks directory to backup location: '${new_blocks_dir}'", ("new_blocks_dir", backup_dir));
+    auto now        = fc::time_point::now();
+    auto blocks_dir = fc::path();
+    auto backup_dir = detail::backup_blocks_dir(data_dir, now, blocks_dir);
 
-    fc::create_directories(blocks_dir);
     auto block_log_path = blocks_dir / "blocks.log";
 
     ilog("Reconstructing '${new_block_log}' from backed up block log", ("new_block_log", block_log_path));
@@ -379,10 +1200,7 @@ block_log::repair_log(const fc::path& data_dir, uint32_t truncate_at_block) {
 
     uint32_t version = 0;
     old_block_stream.read((char*)&version, sizeof(version));
-    vros_ASSERT(version > 0, block_log_exception, "Block log was not setup properly with genesis information.");
-    vros_ASSERT(version == block_log::supported_version, block_log_unsupported_version,
-              "Unsupported version of block log. Block log version is ${version} while code supports version ${supported}",
-              ("version", version)("supported", block_log::supported_version));
+    detail::check_version(version);
 
     genesis_state gs;
     fc::raw::unpack(old_block_stream, gs);
@@ -398,48 +1216,98 @@ block_log::repair_log(const fc::path& data_dir, uint32_t truncate_at_block) {
 
     block_id_type previous;
 
-    uint64_t pos = old_block_stream.tellg();
-    while(pos < end_pos) {
-        signed_block tmp;
-
-        try {
-            fc::raw::unpack(old_block_stream, tmp);
-        }
-        catch(...) {
-            except_ptr = std::current_exception();
-            incomplete_block_data.resize(end_pos - pos);
-            old_block_stream.read(incomplete_block_data.data(), incomplete_block_data.size());
-            break;
-        }
-
-        auto id = tmp.id();
+    auto check_link = [&previous](const signed_block& b) {
+        auto id = b.id();
         if(block_header::num_from_id(previous) + 1 != block_header::num_from_id(id)) {
             elog("Block ${num} (${id}) skips blocks. Previous block in block log is block ${prev_num} (${previous})",
                  ("num", block_header::num_from_id(id))("id", id)("prev_num", block_header::num_from_id(previous))("previous", previous));
         }
-        if(previous != tmp.previous) {
+        if(previous != b.previous) {
             elog("Block ${num} (${id}) does not link back to previous block. "
                  "Expected previous: ${expected}. Actual previous: ${actual}.",
-                 ("num", block_header::num_from_id(id))("id", id)("expected", previous)("actual", tmp.previous));
+                 ("num", block_header::num_from_id(id))("id", id)("expected", previous)("actual", b.previous));
         }
         previous = id;
+    };
 
-        uint64_t tmp_pos = std::numeric_limits<uint64_t>::max();
-        if((static_cast<uint64_t>(old_block_stream.tellg()) + sizeof(pos)) <= end_pos) {
-            old_block_stream.read(reinterpret_cast<char*>(&tmp_pos), sizeof(tmp_pos));
-        }
-        if(pos != tmp_pos) {
-            bad_block = tmp;
-            break;
+    uint64_t pos = old_block_stream.tellg();
+    if(version == 1) {
+        while(pos < end_pos) {
+            signed_block tmp;
+
+            try {
+                fc::raw::unpack(old_block_stream, tmp);
+            }
+            catch(...) {
+                except_ptr = std::current_exception();
+                incomplete_block_data.resize(end_pos - pos);
+                old_block_stream.read(incomplete_block_data.data(), incomplete_block_data.size());
+                break;
+            }
+
+            check_link(tmp);
+
+            uint64_t tmp_pos = std::numeric_limits<uint64_t>::max();
+            if((static_cast<uint64_t>(old_block_stream.tellg()) + sizeof(pos)) <= end_pos) {
+                old_block_stream.read(reinterpret_cast<char*>(&tmp_pos), sizeof(tmp_pos));
+            }
+            if(pos != tmp_pos) {
+                bad_block = tmp;
+                break;
+            }
+
+            auto data = fc::raw::pack(tmp);
+            new_block_stream.write(data.data(), data.size());
+            new_block_stream.write(reinterpret_cast<char*>(&pos), sizeof(pos));
+            block_num = tmp.block_num();
+            pos       = new_block_stream.tellp();
+            if(block_num == truncate_at_block)
+                break;
         }
+    }
+    else {
+        detail::mapped_log_file old_map;
+        old_map.open(backup_dir / "blocks.log");
+        auto m = old_map.remap();
+
+        while(pos < end_pos) {
+            auto c      = detail::decoded_chunk_ptr();
+            auto blocks = vector<signed_block_ptr>();
+
+            try {
+                c = detail::decode_chunk(m, pos);
+                for(auto n = c->header.first_block_num; n <= c->header.last_block_num(); n++) {
+                    blocks.emplace_back(c->read_block(n));
+                }
+            }
+            catch(...) {
+                except_ptr = std::current_exception();
+                incomplete_block_data.assign(m->data() + pos, m->data() + end_pos);
+                break;
+            }
 
-        auto data = fc::raw::pack(tmp);
-        new_block_stream.write(data.data(), data.size());
-        new_block_stream.write(reinterpret_cast<char*>(&pos), sizeof(pos));
-        block_num = tmp.block_num();
-        pos       = new_block_stream.tellp();
-        if(block_num == truncate_at_block)
-            break;
+            if(m->read_u64(pos + c->header.size()) != pos) {
+                bad_block = *blocks.back();
+                break;
+            }
+
+            // chunk is rewritten, only blocks up to `truncate_at_block` are kept
+            auto count = 0u;
+            while(count < blocks.size()) {
+                check_link(*blocks[count]);
+                if(blocks[count++]->block_num() == truncate_at_block)
+                    break;
+            }
+            auto raw_end = count < c->header.blocks ? c->offsets[count] : c->header.raw_size;
+            auto raw     = bytes(c->data, c->data + raw_end);
+            auto offsets = std::vector<uint32_t>(c->offsets.begin(), c->offsets.begin() + count);
+            detail::write_chunk(new_block_stream, nullptr, c->header.first_block_num, offsets, raw);
+
+            block_num = blocks[count - 1]->block_num();
+            pos      += c->header.size() + sizeof(uint64_t);
+            if(block_num == truncate_at_block)
+                break;
+        }
     }
 
     if(bad_block.valid()) {
@@ -482,6 +1350,12 @@ block_log::repair_log(const fc::path& data_dir, uint32_t truncate_at_block) {
     }
     else {
         ilog("Existing block log was undamaged. Recovered all irreversible blocks up to block number ${num}.", ("num", block_num));
+
+        // blocks of pending chunk follow the recovered ones, opening the log checks them again
+        auto pending_path = backup_dir / "blocks.pending";
+        if(version > 1 && block_num != truncate_at_block && fc::exists(pending_path)) {
+            fc::copy(pending_path, blocks_dir / "blocks.pending");
+        }
     }
 
     return backup_dir;
@@ -497,14 +1371,118 @@ block_log::extract_genesis_state(const fc::path& data_dir) {
 
     uint32_t version = 0;
     block_stream.read((char*)&version, sizeof(version));
-    vros_ASSERT(version > 0, block_log_exception, "Block log was not setup properly with genesis information.");
-    vros_ASSERT(version == block_log::supported_version, block_log_unsupported_version,
-              "Unsupported version of block log. Block log version is ${version} while code supports version ${supported}",
-              ("version", version)("supported", block_log::supported_version));
+    detail::check_version(version);
 
     genesis_state gs;
     fc::raw::unpack(block_stream, gs);
     return gs;
 }
 
+fc::path
+block_log::convert_log(const fc::path& data_dir, uint32_t blocks_per_chunk) {
+    ilog("Converting Block Log...");
+    vros_ASSERT(blocks_per_chunk > 0, block_log_exception, "There should be at least one block in a chunk");
+
+    auto now        = fc::time_point::now();
+    auto blocks_dir = fc::path();
+    auto backup_dir = detail::backup_blocks_dir(data_dir, now, blocks_dir);
+
+    auto gs = extract_genesis_state(backup_dir);
+
+    // backup is only read through a mapping, it's kept as it was
+    detail::mapped_log_file old_map;
+    old_map.open(backup_dir / "blocks.log");
+    auto m = old_map.remap();
+
+    auto old_version = uint32_t(0);
+    memcpy(&old_version, m->data(), sizeof(old_version));
+    auto first_pos = detail::genesis_end(*m);
+
+    std::fstream new_block_stream;
+    std::fstream new_index_stream;
+    new_block_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+    new_index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+    new_block_stream.open((blocks_dir / "blocks.log").generic_string().c_str(), LOG_WRITE);
+    new_index_stream.open((blocks_dir / "blocks.index").generic_string().c_str(), LOG_WRITE);
+
+    ilog("Writing '${new_block_log}' in version ${v} from backed up block log",
+         ("new_block_log", blocks_dir / "blocks.log")("v", block_log::supported_version));
+
+    auto version = block_log::supported_version;
+    auto data    = fc::raw::pack(gs);
+    new_block_stream.write((char*)&version, sizeof(version));
+    new_block_stream.write(data.data(), data.size());
+
+    auto first    = 0u;
+    auto head_num = 0u;
+    auto chunk    = 0u;  // first block of chunk being collected
+    auto raw      = bytes();
+    auto offsets  = std::vector<uint32_t>();
+
+    auto write = [&]() {
+        detail::write_chunk(new_block_stream, &new_index_stream, chunk, offsets, raw);
+        raw.clear();
+        offsets.clear();
+    };
+    // packed blocks are copied as they are
+    auto add = [&](uint32_t num, const char* packed, size_t size) {
+        vros_ASSERT(head_num == 0 || num == head_num + 1, block_log_exception, "Block ${n} is missing in block log", ("n", head_num + 1));
+        if(head_num == 0) {
+            first = num;
+        }
+        if(offsets.empty()) {
+            chunk = num;
+        }
+        offsets.emplace_back(raw.size());
+        raw.insert(raw.end(), packed, packed + size);
+        head_num = num;
+
+        if(offsets.size() == blocks_per_chunk || raw.size() >= detail::kMaxChunkRawSize) {
+            write();
+        }
+    };
+
+    if(m->size > first_pos) {
+        // start of last block or chunk
+        uint64_t end_pos = m->read_u64(m->size - sizeof(uint64_t));
+
+        if(old_version == 1) {
+            auto ds  = fc::datastream<const char*>(m->data() + first_pos, m->size - first_pos);
+            auto pos = uint64_t(0);
+            do {
+                auto begin = ds.pos();
+                auto b     = signed_block();
+                fc::raw::unpack(ds, b);
+                add(b.block_num(), begin, ds.pos() - begin);
+                ds.read((char*)&pos, sizeof(pos));
+            } while(pos < end_pos);
+        }
+        else {
+            uint64_t pos = first_pos;
+            while(pos <= end_pos) {
+                auto c = detail::decode_chunk(m, pos);
+                for(auto i = 0u; i < c->header.blocks; i++) {
+                    auto begin = c->offsets[i];
+                    auto end   = (i + 1 < c->header.blocks) ? c->offsets[i + 1] : c->header.raw_size;
+                    add(c->header.first_block_num + i, c->data + begin, end - begin);
+                }
+                pos += c->header.size() + sizeof(uint64_t);
+            }
+        }
+    }
+    if(old_version > 1) {
+        for(auto& b : detail::read_pending_blocks(backup_dir / "blocks.pending", head_num)) {
+            add(b.first->block_num(), b.second.data(), b.second.size());
+        }
+    }
+    if(!offsets.empty()) {
+        write();
+    }
+    new_block_stream.flush();
+    new_index_stream.flush();
+
+    ilog("Converted blocks from ${first} to ${head}", ("first", first)("head", head_num));
+    return backup_dir;
+}
+
 }}  // namespace vros::chain
@@ -32,6 +32,48 @@ group::visit_node(const node& node, const visit_func& func) const {
     }
 }
 
+void
+group::compile() const {
+    vros_ASSERT(nodes_.size() > 0, group_type_exception, "There's not any node defined in this group");
+
+    auto prog = std::make_shared<program>();
+    prog->ops.reserve(nodes_.size());
+    for(auto& n : nodes_) {
+        auto o      = program::op();
+        o.weight    = n.weight;
+        o.threshold = n.threshold;
+        o.index     = n.index;
+        o.size      = n.size;
+        o.leaf      = n.is_leaf();
+        o.uniform   = false;
+
+        if(o.leaf) {
+            vros_ASSERT(n.index < keys_.size(), group_type_exception, "Key index of leaf node is not valid");
+        }
+        else {
+            vros_ASSERT((size_t)n.index + n.size <= nodes_.size(), group_type_exception, "Child nodes are not valid");
+
+            // keys of leaf-only children are allocated in order, check it anyway
+            auto& first = nodes_[n.index];
+            o.uniform   = first.is_leaf() && first.weight > 0;
+            for(uint i = 0; o.uniform && i < n.size; i++) {
+                auto& c   = nodes_[n.index + i];
+                o.uniform = c.is_leaf() && c.weight == first.weight && c.index == first.index + i;
+            }
+        }
+        prog->ops.emplace_back(o);
+    }
+    program_ = std::move(prog);
+}
+
+const group::program&
+group::compiled() const {
+    if(!program_) {
+        compile();
+    }
+    return *program_;
+}
+
 }}}  // namespac vros::chain::contracts
 
 namespace fc {
@@ -443,9 +443,11 @@ vros_ACTION_IMPL(issuefungible) {
         auto addr = get_fungible_address(sym);
         vros_ASSERT(addr != ifact.address, fungible_address_exception, "From and to are the same address");
 
-        asset from, to;
-        tokendb.read_asset(addr, sym, from);
-        tokendb.read_asset_no_throw(ifact.address, sym, to);
+        auto assets = std::vector<asset>();
+        tokendb.read_assets({ { addr, sym }, { ifact.address, sym } }, assets, 1);
+
+        auto& from = assets[0];
+        auto& to   = assets[1];
 
         vros_ASSERT(from >= ifact.number, fungible_supply_exception, "Exceeds total supply of ${sym} fungible tokens.", ("sym",sym));
 
@@ -471,10 +473,11 @@ vros_ACTION_IMPL(transferft) {
 
         auto& tokendb = context.token_db;
         
-        auto facc = asset(0, sym);
-        auto tacc = asset(0, sym);
-        tokendb.read_asset(tfact.from, sym, facc);
-        tokendb.read_asset_no_throw(tfact.to, sym, tacc);
+        auto assets = std::vector<asset>();
+        tokendb.read_assets({ { tfact.from, sym }, { tfact.to, sym } }, assets, 1);
+
+        auto& facc = assets[0];
+        auto& tacc = assets[1];
 
         vros_ASSERT(facc >= tfact.number, balance_exception, "Address does not have enough balance left.");
 
@@ -498,10 +501,11 @@ vros_ACTION_IMPL(vros2pvros) {
 
         auto& tokendb = context.token_db;
         
-        auto facc = asset(0, vros_sym());
-        auto tacc = asset(0, pvros_sym());
-        tokendb.read_asset(epact.from, vros_sym(), facc);
-        tokendb.read_asset_no_throw(epact.to, pvros_sym(), tacc);
+        auto assets = std::vector<asset>();
+        tokendb.read_assets({ { epact.from, vros_sym() }, { epact.to, pvros_sym() } }, assets, 1);
+
+        auto& facc = assets[0];
+        auto& tacc = assets[1];
 
         vros_ASSERT(facc >= epact.number, balance_exception, "Address does not have enough balance left.");
 
@@ -836,8 +840,15 @@ vros_ACTION_IMPL(paycharge) {
 
         uint64_t paid = 0;
 
-        asset vros, pvros;
-        tokendb.read_asset_no_throw(pcact.payer, pvros_sym(), pvros);
+        // vros of payer is only read when pinned vros isn't enough
+        auto addr   = get_fungible_address(vros_sym());
+        auto assets = std::vector<asset>();
+        tokendb.read_assets({ { addr, vros_sym() }, { pcact.payer, pvros_sym() } }, assets, 1);
+
+        auto& vros_asset = assets[0];
+        auto& pvros      = assets[1];
+
+        asset vros;
         paid = std::min(pcact.charge, (uint32_t)pvros.amount());
         if(paid > 0) {
             pvros -= asset(paid, pvros_sym());
@@ -854,9 +865,6 @@ vros_ACTION_IMPL(paycharge) {
             tokendb.update_asset(pcact.payer, vros);
         }
 
-        asset vros_asset;
-        auto addr = get_fungible_address(vros_sym());
-        tokendb.read_asset(addr, vros_sym(), vros_asset);
         vros_asset += asset(paid, vros_sym());
     }
     vros_CAPTURE_AND_RETHROW(tx_apply_exception);
@@ -981,10 +989,11 @@ vros_ACTION_IMPL(everipay) {
         auto payer = address(*keys.begin());
         vros_ASSERT(payer != epact.payee, everipay_exception, "Payer and payee shouldn't be the same one");
 
-        auto facc = asset(0, sym);
-        auto tacc = asset(0, sym);
-        tokendb.read_asset(payer, sym, facc);
-        tokendb.read_asset_no_throw(epact.payee, sym, tacc);
+        auto assets = std::vector<asset>();
+        tokendb.read_assets({ { payer, sym }, { epact.payee, sym } }, assets, 1);
+
+        auto& facc = assets[0];
+        auto& tacc = assets[1];
 
         vros_ASSERT(facc >= epact.number, everipay_exception, "Payer does not have enough balance left.");
 
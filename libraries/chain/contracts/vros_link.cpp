@@ -13,6 +13,7 @@
 #include <fc/crypto/hex.hpp>
 #include <fc/crypto/elliptic.hpp>
 #include <vros/chain/exceptions.hpp>
+#include <vros/chain/signature_cache.hpp>
 
 using namespace boost::multiprecision;
 
@@ -233,7 +234,7 @@ vros_link::restore_keys() const {
 
     keys.reserve(signatures_.size());
     for(auto& sig : signatures_) {
-        keys.emplace(public_key_type(sig, hash));
+        keys.emplace(signature_cache::instance().recover(sig, hash));
     }
     return keys;
 }
@@ -10,6 +10,8 @@
 #include <vros/chain/fork_database.hpp>
 #include <vros/chain/token_database.hpp>
 #include <vros/chain/charge_manager.hpp>
+#include <vros/chain/signature_cache.hpp>
+#include <vros/chain/thread_utils.hpp>
 
 #include <vros/chain/block_summary_object.hpp>
 #include <vros/chain/global_property_object.hpp>
@@ -21,6 +23,8 @@
 #include <fc/io/json.hpp>
 #include <fc/scoped_exit.hpp>
 
+#include <thread>
+
 #include <vros/chain/contracts/vros_contract.hpp>
 #include <vros/chain/contracts/vros_org.hpp>
 
@@ -41,6 +45,10 @@ struct pending_state {
 
     vector<action_receipt> _actions;
 
+    // merkle trees of actions and receipts are built as they are added, so finalizing block doesn't hash them all
+    incremental_merkle _action_merkle;
+    incremental_merkle _trx_merkle;
+
     controller::block_status _block_status = controller::block_status::incomplete;
 
     void
@@ -50,6 +58,17 @@ struct pending_state {
     }
 };
 
+/**
+ *  Input transaction of a block prepared in the thread pool before it's applied.
+ *  `preauthorized` only holds for the block it was prepared for, so it's kept
+ *  apart from the metadata which may be pushed again on other forks.
+ */
+struct prepared_transaction {
+    transaction_metadata_ptr mtrx;
+    bool                     preauthorized = false;  ///< authorization is already checked against the snapshot of the block
+    token_read_set           reads;                  ///< objects read by the check, it's redone if any of them is changed before
+};
+
 struct controller_impl {
     controller&             self;
     chainbase::database     db;
@@ -64,6 +83,10 @@ struct controller_impl {
     bool                    replaying = false;
     bool                    in_trx_requiring_checks = false; ///< if true, checks that are normally skipped on replay (e.g. auth checks) cannot be skipped
     abi_serializer          system_api;
+    boost::asio::thread_pool thread_pool;
+
+    signed_block_ptr                          prepared_block;  ///< block whose transactions are prepared by replay read-ahead
+    vector<std::future<prepared_transaction>> prepared_mtrxs;
 
     /**
     *  Transactions that were undone by pop_block or abort_block, transactions
@@ -97,12 +120,15 @@ struct controller_impl {
         , reversible_blocks(cfg.blocks_dir/config::reversible_blocks_dir_name,
              cfg.read_only ? database::read_only : database::read_write,
              cfg.reversible_cache_size)
-        , blog(cfg.blocks_dir)
+        , blog(cfg.blocks_dir, cfg.blocks_retain_size)
         , fork_db(cfg.state_dir)
-        , token_db(cfg.tokendb_dir)
+        , token_db(cfg.tokendb_dir, cfg.tokendb_cache_size)
         , conf(cfg)
         , chain_id(cfg.genesis.compute_chain_id())
-        , system_api(contracts::vros_contract_abi()) {
+        , system_api(contracts::vros_contract_abi())
+        , thread_pool(cfg.thread_pool_size) {
+        FC_ASSERT(cfg.thread_pool_size > 0, "At least one thread is required in controller thread pool");
+        signature_cache::instance().set_capacity(cfg.sigs_cache_size);
 
         fork_db.irreversible.connect([&](auto b) {
             on_irreversible(b);
@@ -170,6 +196,106 @@ struct controller_impl {
         emit(self.irreversible_block, s);
     }
 
+    /**
+    *  Irreversible blocks replayed from block log were fully validated when they were applied at first,
+    *  only their state transitions need to be applied again. Checks which don't change states (expiration,
+    *  tapos, max charge and balance of payer) are skipped, and the block id check in `apply_block` still
+    *  guarantees the replayed states match the original ones.
+    */
+    bool
+    skip_trx_checks() const {
+        return replaying && !conf.force_all_checks && !in_trx_requiring_checks
+            && pending && pending->_block_status == controller::block_status::irreversible;
+    }
+
+    /**
+    *  Replays the blocks in block log after the head block up to `end_num`, returns the number of replayed blocks.
+    *
+    *  Replay is pipelined: a reader thread reads and decodes blocks in order from block log and posts the
+    *  unpacking (and key recovery if required) of their transactions to the thread pool. Prepared blocks are
+    *  passed through a bounded queue, so only the application of blocks is left to this thread.
+    *  Block log is only read by the reader thread until it's joined, appending is not needed for these blocks.
+    */
+    uint32_t
+    replay_irreversible_blocks(uint32_t end_num) {
+        struct replay_block {
+            signed_block_ptr                          block;
+            vector<std::future<prepared_transaction>> mtrxs;
+        };
+
+        bounded_queue<replay_block> queue(config::default_replay_read_ahead_blocks);
+
+        auto reader_error = std::exception_ptr();
+        // keys are only used when checks are forced, see `skip_trx_checks`
+        auto recover_keys = conf.force_all_checks;
+
+        auto reader = std::thread([&, recover_keys, num = head->block_num + 1]() mutable {
+            try {
+                while(num <= end_num) {
+                    auto b = blog.read_block_by_num(num);
+                    if(!b) {
+                        break;
+                    }
+
+                    auto rb  = replay_block();
+                    rb.block = b;
+                    rb.mtrxs.resize(b->transactions.size());
+                    for(auto i = 0u; i < b->transactions.size(); i++) {
+                        if(b->transactions[i].type != transaction_receipt::input) {
+                            continue;
+                        }
+                        rb.mtrxs[i] = async_thread_pool(thread_pool, [this, b, i, recover_keys]() {
+                            auto ptrx = prepared_transaction();
+                            ptrx.mtrx = std::make_shared<transaction_metadata>(b->transactions[i].trx);
+                            if(recover_keys) {
+                                try {
+                                    ptrx.mtrx->recover_keys(chain_id);
+                                }
+                                catch(...) {
+                                    // reported again when the transaction is applied
+                                }
+                            }
+                            return ptrx;
+                        });
+                    }
+                    if(!queue.push(std::move(rb))) {
+                        break;
+                    }
+                    num++;
+                }
+            }
+            catch(...) {
+                reader_error = std::current_exception();
+            }
+            queue.close();
+        });
+        auto join_reader = fc::make_scoped_exit([&]() {
+            queue.close();
+            reader.join();
+            prepared_block.reset();
+            prepared_mtrxs.clear();
+        });
+
+        auto start = fc::time_point::now();
+        auto irr   = 0u;
+        auto rb    = replay_block();
+        while(queue.pop(rb)) {
+            prepared_block = rb.block;
+            prepared_mtrxs = std::move(rb.mtrxs);
+            self.push_block(rb.block, controller::block_status::irreversible);
+
+            if(++irr % 1000 == 0) {
+                auto elapsed = std::max((fc::time_point::now() - start).count(), (int64_t)1) / 1000000.0;
+                std::cerr << std::setw(10) << rb.block->block_num() << " of " << end_num
+                          << std::setw(10) << (uint32_t)(irr / elapsed) << " blocks/s\r";
+            }
+        }
+        if(reader_error) {
+            std::rethrow_exception(reader_error);
+        }
+        return irr;
+    }
+
     void
     init() {
         /**
@@ -183,16 +309,14 @@ struct controller_impl {
             initialize_token_db();
             auto end = blog.read_head();
             if(end && end->block_num() > 1) {
+                vros_ASSERT(blog.first_block_num() == 1, block_log_pruned,
+                    "Block log starts from block ${n}, blocks before it are pruned and cannot be replayed", ("n", blog.first_block_num()));
                 replaying = true;
                 ilog( "existing block log, attempting to replay ${n} blocks", ("n",end->block_num()) );
 
-                auto start = fc::time_point::now();
-                while(auto next = blog.read_block_by_num(head->block_num + 1)) {
-                    self.push_block(next, controller::block_status::irreversible);
-                    if(next->block_num() % 100 == 0) {
-                        std::cerr << std::setw(10) << next->block_num() << " of " << end->block_num() <<"\r";
-                    }
-                }
+                auto start   = fc::time_point::now();
+                auto irr     = replay_irreversible_blocks(end->block_num());
+                auto irr_end = fc::time_point::now();
 
                 int rev = 0;
                 while(auto obj = reversible_blocks.find<reversible_block_object,by_num>(head->block_num+1)) {
@@ -203,6 +327,9 @@ struct controller_impl {
                 std::cerr<< "\n";
                 ilog("${n} reversible blocks replayed", ("n",rev));
                 auto end = fc::time_point::now();
+                ilog("replayed ${n} irreversible blocks in ${duration} seconds, ${bps} blocks/s",
+                    ("n", irr)("duration", (irr_end-start).count()/1000000)
+                    ("bps", irr * 1000000.0 / std::max<int64_t>((irr_end-start).count(), 1)));
                 ilog("replayed ${n} blocks in ${duration} seconds, ${mspb} ms/block",
                     ("n", head->block_num)("duration", (end-start).count()/1000000)
                     ("mspb", ((end-start).count()/1000.0)/head->block_num));
@@ -242,6 +369,9 @@ struct controller_impl {
     }
 
     ~controller_impl() {
+        thread_pool.stop();
+        thread_pool.join();
+
         pending.reset();
 
         db.flush();
@@ -378,6 +508,7 @@ struct controller_impl {
 
         // push the state for pending.
         pending->push();
+        token_db.commit_staging();
     }
 
     // The returned scoped_exit should not exceed the lifetime of the pending which existed when make_block_restore_point was called.
@@ -386,14 +517,21 @@ struct controller_impl {
         auto orig_block_transactions_size = pending->_pending_block_state->block->transactions.size();
         auto orig_state_transactions_size = pending->_pending_block_state->trxs.size();
         auto orig_state_actions_size      = pending->_actions.size();
+        // active nodes of merkle trees are at most log2(n) + 1 digests, cheap to copy
+        auto orig_action_merkle           = pending->_action_merkle;
+        auto orig_trx_merkle              = pending->_trx_merkle;
 
         std::function<void()> callback = [this,
                                           orig_block_transactions_size,
                                           orig_state_transactions_size,
-                                          orig_state_actions_size]() {
+                                          orig_state_actions_size,
+                                          orig_action_merkle = std::move(orig_action_merkle),
+                                          orig_trx_merkle    = std::move(orig_trx_merkle)]() {
             pending->_pending_block_state->block->transactions.resize(orig_block_transactions_size);
             pending->_pending_block_state->trxs.resize(orig_state_transactions_size);
             pending->_actions.resize(orig_state_actions_size);
+            pending->_action_merkle = orig_action_merkle;
+            pending->_trx_merkle    = orig_trx_merkle;
         };
 
         return fc::make_scoped_exit(std::move(callback));
@@ -402,16 +540,28 @@ struct controller_impl {
     /**
     *  Adds the transaction receipt to the pending block and returns it.
     */
-    template <typename T>
     const transaction_receipt&
-    push_receipt(const T& trx, transaction_receipt_header::status_enum status, transaction_receipt_header::type_enum type) {
-        pending->_pending_block_state->block->transactions.emplace_back(trx);
+    push_receipt(const transaction_metadata& trx, transaction_receipt_header::status_enum status, transaction_receipt_header::type_enum type) {
+        pending->_pending_block_state->block->transactions.emplace_back(trx.packed_trx);
         transaction_receipt& r = pending->_pending_block_state->block->transactions.back();
         r.status               = status;
         r.type                 = type;
+        // packed digest is hashed with the metadata, mostly on the thread pool, only the small receipt is hashed here
+        pending->_trx_merkle.append(r.digest(trx.packed_digest));
         return r;
     }
 
+    /**
+    *  Adds the actions executed by a transaction to the pending block.
+    */
+    void
+    push_actions(vector<action_receipt>&& executed) {
+        for(const auto& a : executed) {
+            pending->_action_merkle.append(a.digest());
+        }
+        fc::move_append(pending->_actions, move(executed));
+    }
+
     bool
     failure_is_subjective(const fc::exception& e) {
         auto code = e.code();
@@ -459,11 +609,11 @@ struct controller_impl {
 
                 auto restore = make_block_restore_point();
 
-                trace->receipt = push_receipt(trx->packed_trx,
+                trace->receipt = push_receipt(*trx,
                                               transaction_receipt::executed,
                                               transaction_receipt::suspend);
 
-                fc::move_append(pending->_actions, move(trx_context.executed));
+                push_actions(move(trx_context.executed));
 
                 emit(self.applied_transaction, trace);
 
@@ -481,12 +631,12 @@ struct controller_impl {
             trace->elapsed = fc::time_point::now() - trx_context.start;
 
             if(failure_is_subjective(*trace->except)) {
-                trace->receipt = push_receipt(trx->packed_trx,
+                trace->receipt = push_receipt(*trx,
                                               transaction_receipt::soft_fail,
                                               transaction_receipt::suspend);
             }
             else {
-                trace->receipt = push_receipt(trx->packed_trx,
+                trace->receipt = push_receipt(*trx,
                                               transaction_receipt::hard_fail,
                                               transaction_receipt::suspend);
             }
@@ -503,13 +653,16 @@ struct controller_impl {
     transaction_trace_ptr
     push_transaction(const transaction_metadata_ptr& trx,
                      fc::time_point                  deadline,
-                     bool                            implicit) {
+                     bool                            implicit,
+                     bool                            preauthorized = false) {
         vros_ASSERT(deadline != fc::time_point(), transaction_exception, "deadline cannot be uninitialized");
 
         transaction_trace_ptr trace;
         try {
             transaction_context trx_context(self, *trx);
             trx_context.deadline = deadline;
+            // action traces are only consumed by observers of applied transactions
+            trx_context.record_traces = !skip_trx_checks() || !self.applied_transaction.empty();
             trace                = trx_context.trace;
             try {
                 if(implicit) {
@@ -519,7 +672,7 @@ struct controller_impl {
                     trx_context.init_for_input_trx(trx->trx.signatures.size());
                 }
 
-                if(!self.skip_auth_check() && !implicit) {
+                if(!self.skip_auth_check() && !implicit && !preauthorized) {
                     const auto& keys = trx->recover_keys(chain_id);
                     check_authorization(keys, trx->trx);
                 }
@@ -530,7 +683,7 @@ struct controller_impl {
                 auto restore = make_block_restore_point();
 
                 if(!implicit) {
-                    trace->receipt = push_receipt(trx->packed_trx,
+                    trace->receipt = push_receipt(*trx,
                                                   transaction_receipt::executed,
                                                   transaction_receipt::input);
                     pending->_pending_block_state->trxs.emplace_back(trx);
@@ -541,7 +694,7 @@ struct controller_impl {
                     trace->receipt = r;
                 }
 
-                fc::move_append(pending->_actions, move(trx_context.executed));
+                push_actions(move(trx_context.executed));
 
                 // call the accept signal but only once for this transaction
                 if(!trx->accepted) {
@@ -583,7 +736,8 @@ struct controller_impl {
             pending.reset();
         });
 
-        pending = pending_state(db.start_undo_session(true), token_db.new_savepoint_session(db.revision()));
+        // token database changes of the pending block are staged in memory and written once in commit_block
+        pending = pending_state(db.start_undo_session(true), token_db.new_staging_session(db.revision()));
 
         pending->_block_status = s;
 
@@ -597,7 +751,7 @@ struct controller_impl {
         const auto& gpo = db.get<global_property_object>();
         if(gpo.proposed_schedule_block_num.valid() &&                                                          // if there is a proposed schedule that was proposed in a block ...
            (*gpo.proposed_schedule_block_num <= pending->_pending_block_state->dpos_irreversible_blocknum) &&  // ... that has now become irreversible ...
-           pending->_pending_block_state->pending_schedule.producers.size() == 0 &&                            // ... and there is room for a new pending schedule ...
+           pending->_pending_block_state->pending_schedule->producers.size() == 0 &&                            // ... and there is room for a new pending schedule ...
            !was_pending_promoted                                                                               // ... and not just because it was promoted to active at the start of this block, then:
         ) {
             // Promote proposed schedule to pending schedule.
@@ -626,6 +780,56 @@ struct controller_impl {
         static_cast<signed_block_header&>(*p->block) = p->header;
     }  /// sign_block
 
+    /**
+    *  Unpacks input transactions of the block, recovers their signing keys and checks their authorizations
+    *  in the thread pool. Signing keys are recovered when replaying reversible blocks since checking payer needs
+    *  them, and are not recovered at all when replaying irreversible blocks.
+    *  Authorizations are checked against the token database snapshot taken at the beginning of the block,
+    *  the results are only used when no prior transaction changes the domains, tokens, groups, fungibles or
+    *  suspends they read.
+    *  Failed checks are left to `push_transaction` which checks them again and reports the errors.
+    *
+    *  Futures are returned in the order of receipts (invalid ones for non-input receipts) so that
+    *  applying transactions overlaps with preparing the following ones.
+    */
+    vector<std::future<prepared_transaction>>
+    prepare_block_transactions(const signed_block_ptr& b) {
+        auto skip_auth = self.skip_auth_check();
+        auto skip_keys = skip_trx_checks();
+        auto snapshot  = token_db.new_snapshot();
+        auto depth     = db.get<global_property_object>().configuration.max_authority_depth;
+
+        auto futures = vector<std::future<prepared_transaction>>(b->transactions.size());
+        for(auto i = 0u; i < b->transactions.size(); i++) {
+            if(b->transactions[i].type != transaction_receipt::input) {
+                continue;
+            }
+            futures[i] = async_thread_pool(thread_pool, [this, b, i, skip_auth, skip_keys, snapshot, depth]() {
+                auto ptrx = prepared_transaction();
+                ptrx.mtrx = std::make_shared<transaction_metadata>(b->transactions[i].trx);
+                if(skip_keys) {
+                    return ptrx;
+                }
+                try {
+                    auto& keys = ptrx.mtrx->recover_keys(chain_id);
+                    if(!skip_auth) {
+                        auto checker = authority_checker(self, keys, *snapshot, depth);
+
+                        ptrx.preauthorized = std::all_of(ptrx.mtrx->trx.actions.cbegin(), ptrx.mtrx->trx.actions.cend(), [&](auto& act) {
+                            return checker.satisfied(act);
+                        });
+                        ptrx.reads = checker.read_set();
+                    }
+                }
+                catch(...) {
+                    ptrx.preauthorized = false;
+                }
+                return ptrx;
+            });
+        }
+        return futures;
+    }
+
     void
     apply_block(const signed_block_ptr& b, controller::block_status s) {
         try {
@@ -633,14 +837,36 @@ struct controller_impl {
                 vros_ASSERT(b->block_extensions.size() == 0, block_validate_exception, "no supported extensions");
                 start_block(b->timestamp, b->confirmed, s);
 
+                auto mtrxs = vector<std::future<prepared_transaction>>();
+                if(prepared_block == b) {
+                    mtrxs = std::move(prepared_mtrxs);
+                    prepared_block.reset();
+                }
+                else {
+                    mtrxs = prepare_block_transactions(b);
+                }
+                // pending block may be aborted, wait for tasks still reading it
+                auto wait_mtrxs = fc::make_scoped_exit([&mtrxs]() {
+                    for(auto& f : mtrxs) {
+                        if(f.valid()) {
+                            f.wait();
+                        }
+                    }
+                });
+
                 auto num_pending_receipts = pending->_pending_block_state->block->transactions.size();
-                for(const auto& receipt : b->transactions) {
-                    auto trace = transaction_trace_ptr();
+                for(auto i = 0u; i < b->transactions.size(); i++) {
+                    auto& receipt = b->transactions[i];
+                    auto  trace   = transaction_trace_ptr();
                     if(receipt.type == transaction_receipt::input) {
-                        auto& pt    = receipt.trx;
-                        auto  mtrx  = std::make_shared<transaction_metadata>(pt);
-                        
-                        trace = push_transaction(mtrx, fc::time_point::maximum(), false);
+                        auto ptrx = mtrxs[i].get();
+                        if(ptrx.preauthorized && token_db.is_staging_written(ptrx.reads)) {
+                            // prior transactions in this block changed objects the speculative check read
+                            // its result is not reliable anymore, check it again
+                            ptrx.preauthorized = false;
+                        }
+
+                        trace = push_transaction(ptrx.mtrx, fc::time_point::maximum(), false, ptrx.preauthorized);
                     }
                     else if(receipt.type == transaction_receipt::suspend) {
                         // suspend transaction is executed in its parent transaction
@@ -676,6 +902,13 @@ struct controller_impl {
 
                 finalize_block();
 
+                vros_ASSERT(b->transaction_mroot == pending->_pending_block_state->header.transaction_mroot,
+                       block_validate_exception, "Transaction merkle root does not match",
+                       ("producer_mroot",b->transaction_mroot)("validator_mroot",pending->_pending_block_state->header.transaction_mroot));
+                vros_ASSERT(b->action_mroot == pending->_pending_block_state->header.action_mroot,
+                       block_validate_exception, "Action merkle root does not match",
+                       ("producer_mroot",b->action_mroot)("validator_mroot",pending->_pending_block_state->header.action_mroot));
+
                 // this implicitly asserts that all header fields (less the signature) are identical
                 vros_ASSERT(b->id() == pending->_pending_block_state->header.id(),
                        block_validate_exception, "Block ID does not match",
@@ -766,7 +999,7 @@ struct controller_impl {
                     apply_block((*ritr)->block,  (*ritr)->validated ? controller::block_status::validated : controller::block_status::complete);
                     head = *ritr;
                     fork_db.mark_in_current_chain(*ritr, true);
-                    (*ritr)->validated = true;
+                    fork_db.set_validity(*ritr, true);
                 }
                 catch(const fc::exception& e) {
                     except = e;
@@ -816,27 +1049,15 @@ struct controller_impl {
         return false;
     }
 
+    // incremental merkle duplicates the last node of odd levels the same as merkle() does, roots are identical
     void
     set_action_merkle() {
-        vector<digest_type> action_digests;
-        action_digests.reserve(pending->_actions.size());
-        for(const auto& a : pending->_actions) {
-            action_digests.emplace_back(a.digest());
-        }
-
-        pending->_pending_block_state->header.action_mroot = merkle(move(action_digests));
+        pending->_pending_block_state->header.action_mroot = pending->_action_merkle.get_root();
     }
 
     void
     set_trx_merkle() {
-        vector<digest_type> trx_digests;
-        const auto&         trxs = pending->_pending_block_state->block->transactions;
-        trx_digests.reserve(trxs.size());
-        for(const auto& trx : trxs) {
-            trx_digests.emplace_back(trx.digest());
-        }
-
-        pending->_pending_block_state->header.transaction_mroot = merkle(move(trx_digests));
+        pending->_pending_block_state->header.transaction_mroot = pending->_trx_merkle.get_root();
     }
 
     void
@@ -975,6 +1196,20 @@ controller::push_confirmation(const header_confirmation& c) {
     my->push_confirmation(c);
 }
 
+std::future<transaction_metadata_ptr>
+controller::prepare_transaction(const packed_transaction& trx) {
+    return async_thread_pool(my->thread_pool, [trx, chain_id = my->chain_id]() {
+        auto mtrx = std::make_shared<transaction_metadata>(trx);
+        try {
+            mtrx->recover_keys(chain_id);
+        }
+        catch(...) {
+            // invalid signatures are reported when pushing the transaction
+        }
+        return mtrx;
+    });
+}
+
 transaction_trace_ptr
 controller::push_transaction(const transaction_metadata_ptr& trx, fc::time_point deadline) {
     validate_db_available_size();
@@ -1135,6 +1370,9 @@ controller::get_block_id_for_num(uint32_t block_num) const {
             return blk_state->id;
         }
 
+        vros_ASSERT(block_num >= my->blog.first_block_num(), block_log_pruned,
+                   "Block ${block} is pruned, block log starts from block ${first}", ("block", block_num)("first", my->blog.first_block_num()));
+
         auto signed_blk = my->blog.read_block_by_num(block_num);
 
         vros_ASSERT(BOOST_LIKELY(signed_blk != nullptr), unknown_block_exception,
@@ -1180,14 +1418,14 @@ controller::set_proposed_producers(vector<producer_key> producers) {
     decltype(sch.producers.cend()) end;
     decltype(end)                  begin;
 
-    if(my->pending->_pending_block_state->pending_schedule.producers.size() == 0) {
-        const auto& active_sch = my->pending->_pending_block_state->active_schedule;
+    if(my->pending->_pending_block_state->pending_schedule->producers.size() == 0) {
+        const auto& active_sch = *my->pending->_pending_block_state->active_schedule;
         begin                  = active_sch.producers.begin();
         end                    = active_sch.producers.end();
         sch.version            = active_sch.version + 1;
     }
     else {
-        const auto& pending_sch = my->pending->_pending_block_state->pending_schedule;
+        const auto& pending_sch = *my->pending->_pending_block_state->pending_schedule;
         begin                   = pending_sch.producers.begin();
         end                     = pending_sch.producers.end();
         sch.version             = pending_sch.version + 1;
@@ -1243,6 +1481,11 @@ controller::skip_auth_check() const {
     return my->replaying && !my->conf.force_all_checks && !my->in_trx_requiring_checks;
 }
 
+bool
+controller::skip_trx_checks() const {
+    return my->skip_trx_checks();
+}
+
 bool
 controller::loadtest_mode() const {
     return my->conf.loadtest_mode;
@@ -5,48 +5,216 @@
 #include <vros/chain/fork_database.hpp>
 #include <vros/chain/exceptions.hpp>
 
-#include <boost/multi_index/composite_key.hpp>
-#include <boost/multi_index/hashed_index.hpp>
-#include <boost/multi_index/mem_fun.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index_container.hpp>
-#include <fc/io/fstream.hpp>
+#include <algorithm>
+#include <deque>
 #include <fstream>
+#include <tuple>
+#include <unordered_map>
+#include <boost/container/small_vector.hpp>
+#include <fc/io/fstream.hpp>
 
 namespace vros { namespace chain {
-using boost::multi_index_container;
-using namespace boost::multi_index;
-
-struct by_block_id;
-struct by_block_num;
-struct by_lib_block_num;
-struct by_prev;
-typedef multi_index_container<
-    block_state_ptr,
-    indexed_by<hashed_unique<tag<by_block_id>,
-                             member<block_header_state, block_id_type, &block_header_state::id>,
-                             std::hash<block_id_type>>,
-               ordered_non_unique<tag<by_prev>,
-                                  const_mem_fun<block_header_state, const block_id_type&, &block_header_state::prev>>,
-               ordered_non_unique<tag<by_block_num>,
-                                  composite_key<block_state,
-                                                member<block_header_state, uint32_t, &block_header_state::block_num>,
-                                                member<block_state, bool, &block_state::in_current_chain>>,
-                                  composite_key_compare<std::less<uint32_t>, std::greater<bool>>>,
-               ordered_non_unique<
-                   tag<by_lib_block_num>,
-                   composite_key<block_header_state,
-                                 member<block_header_state, uint32_t, &block_header_state::dpos_irreversible_blocknum>,
-                                 member<block_header_state, uint32_t, &block_header_state::bft_irreversible_blocknum>,
-                                 member<block_header_state, uint32_t, &block_header_state::block_num>>,
-                   composite_key_compare<std::greater<uint32_t>, std::greater<uint32_t>, std::greater<uint32_t>>>>>
-    fork_multi_index_type;
 
+/**
+ *  Operations recorded in the journal of fork database, each one is written as
+ *  op (1 byte), size of payload (4 bytes) and payload.
+ */
+enum class journal_op : uint8_t {
+    add = 0,                    ///< block state was inserted, payload: block_state
+    remove,                     ///< block and all forks built off it were removed, payload: block_id_type
+    erase,                      ///< irreversible block was erased, payload: block_id_type
+    validate,                   ///< block was marked as valid, payload: block_id_type
+    mark_in_current_chain,      ///< payload: block_id_type, bool
+    confirm                     ///< confirmation was added, payload: header_confirmation
+};
+
+/**
+ *  Block states are kept in a ring of slots indexed by block number, starting at the
+ *  oldest block. Most slots hold only the block of the current chain, competing forks
+ *  share the slot of their block number. Pruning at LIB pops slots from the front and
+ *  lookups in the current chain by number go directly to the slot.
+ */
 struct fork_database_impl {
-    fork_multi_index_type index;
+    using slot_type = boost::container::small_vector<block_state_ptr, 1>;
+    using id_map    = std::unordered_map<block_id_type, block_state_ptr, std::hash<block_id_type>>;
+
+    std::deque<slot_type> slots;
+    uint32_t              first_num = 0;  ///< block number of slots.front()
+    id_map                by_id;
     block_state_ptr       head;
     fc::path              datadir;
+
+    std::ofstream journal;
+    uint64_t      journal_size    = 0;
+    uint64_t      checkpoint_size = 0;
+    uint64_t      seq             = 0;      ///< sequence of the checkpoint the journal builds on
+    bool          replaying       = false;  ///< journal is being replayed, don't record operations again
+
+    size_t size() const { return by_id.size(); }
+
+    slot_type*
+    get_slot(uint32_t num) {
+        if(slots.empty() || num < first_num || num - first_num >= slots.size()) {
+            return nullptr;
+        }
+        return &slots[num - first_num];
+    }
+
+    bool
+    insert(const block_state_ptr& s) {
+        if(!by_id.emplace(s->id, s).second) {
+            return false;
+        }
+        auto num = s->block_num;
+        if(slots.empty()) {
+            first_num = num;
+        }
+        while(num < first_num) {
+            slots.emplace_front();
+            first_num--;
+        }
+        while(num - first_num >= slots.size()) {
+            slots.emplace_back();
+        }
+
+        slots[num - first_num].emplace_back(s);
+        return true;
+    }
+
+    void
+    erase(const block_state_ptr& s) {
+        by_id.erase(s->id);
+
+        auto slot = get_slot(s->block_num);
+        if(slot != nullptr) {
+            auto it = std::find(slot->begin(), slot->end(), s);
+            if(it != slot->end()) {
+                slot->erase(it);
+            }
+        }
+        while(!slots.empty() && slots.front().empty()) {
+            slots.pop_front();
+            first_num++;
+        }
+        while(!slots.empty() && slots.back().empty()) {
+            slots.pop_back();
+        }
+    }
+
+    void
+    clear() {
+        slots.clear();
+        by_id.clear();
+        first_num = 0;
+    }
+
+    // oldest block, the one in current chain is preferred
+    block_state_ptr
+    oldest() const {
+        for(auto& b : slots.front()) {
+            if(b->in_current_chain) {
+                return b;
+            }
+        }
+        return slots.front().front();
+    }
+
+    template<typename F>
+    void
+    for_each(F&& f) const {
+        for(auto& slot : slots) {
+            for(auto& b : slot) {
+                f(b);
+            }
+        }
+    }
+
+    // head is the block with highest (dpos irreversible, bft irreversible, block number)
+    static bool
+    better_head(const block_state_ptr& a, const block_state_ptr& b) {
+        return std::tie(a->dpos_irreversible_blocknum, a->bft_irreversible_blocknum, a->block_num)
+            > std::tie(b->dpos_irreversible_blocknum, b->bft_irreversible_blocknum, b->block_num);
+    }
+
+    void
+    update_head(const block_state_ptr& s) {
+        if(!head || better_head(s, head)) {
+            head = s;
+        }
+    }
+
+    void
+    reset_head() {
+        head.reset();
+        for_each([this](auto& b) { update_head(b); });
+    }
+
+    template<typename T>
+    void
+    record(journal_op op, const T& v) {
+        if(replaying || !journal.is_open()) {
+            return;
+        }
+        auto     data = fc::raw::pack(v);
+        uint32_t size = data.size();
+        journal.write((char*)&op, sizeof(op));
+        journal.write((char*)&size, sizeof(size));
+        journal.write(data.data(), data.size());
+        journal.flush();
+        journal_size += sizeof(op) + sizeof(size) + size;
+    }
+
+    // starts a new empty journal building on checkpoint of `seq`
+    void
+    open_journal() {
+        auto journal_file = datadir / config::forkdb_journal_filename;
+        auto tmp_file     = fc::path(journal_file.generic_string() + ".tmp");
+        {
+            std::ofstream out(tmp_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ofstream::trunc);
+            fc::raw::pack(out, seq);
+        }
+        if(journal.is_open()) {
+            journal.close();
+        }
+        fc::rename(tmp_file, journal_file);
+        journal.open(journal_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::app);
+        journal_size = sizeof(seq);
+    }
+
+    /**
+     *  Writes all block states into a new checkpoint and starts a new journal after it.
+     *  The checkpoint replaces old one by renaming, and the journal records the sequence
+     *  of the checkpoint it builds on, so a crash at any point leaves a consistent pair.
+     */
+    void
+    checkpoint() {
+        auto fork_db_dat = datadir / config::forkdb_filename;
+        auto tmp_file    = fc::path(fork_db_dat.generic_string() + ".tmp");
+        {
+            std::ofstream out(tmp_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ofstream::trunc);
+            uint32_t num_blocks_in_fork_db = size();
+            fc::raw::pack(out, unsigned_int{num_blocks_in_fork_db});
+            for_each([&out](auto& s) { fc::raw::pack(out, *s); });
+            if(head)
+                fc::raw::pack(out, head->id);
+            else
+                fc::raw::pack(out, block_id_type());
+            fc::raw::pack(out, seq + 1);
+            checkpoint_size = out.tellp();
+        }
+        fc::rename(tmp_file, fork_db_dat);
+
+        seq++;
+        open_journal();
+    }
+
+    // journal is compacted into a new checkpoint once it outgrows the checkpoint
+    void
+    maybe_checkpoint() {
+        if(journal.is_open() && journal_size > std::max<uint64_t>(checkpoint_size * 2, 1024 * 1024)) {
+            checkpoint();
+        }
+    }
 };
 
 fork_database::fork_database(const fc::path& data_dir)
@@ -56,6 +224,8 @@ fork_database::fork_database(const fc::path& data_dir)
     if(!fc::is_directory(my->datadir))
         fc::create_directories(my->datadir);
 
+    my->replaying = true;
+
     auto fork_db_dat = my->datadir / config::forkdb_filename;
     if(fc::exists(fork_db_dat)) {
         string content;
@@ -74,38 +244,140 @@ fork_database::fork_database(const fc::path& data_dir)
 
         my->head = get_block(head_id);
 
-        fc::remove(fork_db_dat);
+        // checkpoints written before journal was introduced have no sequence
+        if(ds.remaining() >= sizeof(my->seq)) {
+            fc::raw::unpack(ds, my->seq);
+        }
+        my->checkpoint_size = content.size();
+    }
+
+    auto journal_file = my->datadir / config::forkdb_journal_filename;
+    auto replayed     = 0u;
+    if(fc::exists(journal_file)) {
+        replayed = replay_journal(journal_file);
+    }
+
+    my->replaying = false;
+    if(replayed > 0) {
+        // replayed operations must stay on disk, write them into a new checkpoint before starting a new journal
+        my->checkpoint();
+    }
+    else {
+        // journal has no complete records, at most a torn one which would break records appended after it
+        my->open_journal();
     }
 }
 
+uint32_t
+fork_database::replay_journal(const fc::path& journal_file) {
+    string content;
+    fc::read_file_contents(journal_file, content);
+
+    fc::datastream<const char*> ds(content.data(), content.size());
+    uint64_t seq = 0;
+    if(ds.remaining() < sizeof(seq)) {
+        return 0;
+    }
+    fc::raw::unpack(ds, seq);
+    if(seq != my->seq) {
+        // journal was already compacted into the checkpoint
+        wlog("Ignore stale fork database journal of checkpoint ${s}, current checkpoint is ${c}", ("s", seq)("c", my->seq));
+        return 0;
+    }
+
+    auto ops = 0u;
+    while(ds.remaining() > 0) {
+        auto     op   = journal_op();
+        uint32_t size = 0;
+        if(ds.remaining() < sizeof(op) + sizeof(size)) {
+            break;
+        }
+        ds.read((char*)&op, sizeof(op));
+        ds.read((char*)&size, sizeof(size));
+        if(ds.remaining() < size) {
+            // last operation was not completely written
+            break;
+        }
+        auto pds = fc::datastream<const char*>(ds.pos(), size);
+        ds.skip(size);
+
+        switch(op) {
+        case journal_op::add: {
+            auto s = std::make_shared<block_state>();
+            fc::raw::unpack(pds, *s);
+            my->insert(s);
+            break;
+        }
+        case journal_op::remove: {
+            auto id = block_id_type();
+            fc::raw::unpack(pds, id);
+            remove(id);
+            break;
+        }
+        case journal_op::erase: {
+            auto id = block_id_type();
+            fc::raw::unpack(pds, id);
+            if(auto b = get_block(id)) {
+                my->erase(b);
+            }
+            break;
+        }
+        case journal_op::validate: {
+            auto id = block_id_type();
+            fc::raw::unpack(pds, id);
+            if(auto b = get_block(id)) {
+                set_validity(b, true);
+            }
+            break;
+        }
+        case journal_op::mark_in_current_chain: {
+            auto id = block_id_type();
+            auto in = false;
+            fc::raw::unpack(pds, id);
+            fc::raw::unpack(pds, in);
+            if(auto b = get_block(id)) {
+                mark_in_current_chain(b, in);
+            }
+            break;
+        }
+        case journal_op::confirm: {
+            auto c = header_confirmation();
+            fc::raw::unpack(pds, c);
+            add(c);
+            break;
+        }
+        default: {
+            vros_THROW(fork_database_exception, "Unknown operation in fork database journal", ("op", (uint32_t)op));
+        }
+        }  // switch
+        ops++;
+    }
+
+    my->reset_head();
+    ilog("Replayed ${n} operations from fork database journal", ("n", ops));
+    return ops;
+}
+
 void
 fork_database::close() {
-    if(my->index.size() == 0)
+    if(my->size() == 0)
         return;
 
-    auto fork_db_dat = my->datadir / config::forkdb_filename;
-    std::ofstream out(fork_db_dat.generic_string().c_str(), std::ios::out | std::ios::binary | std::ofstream::trunc);
-    uint32_t num_blocks_in_fork_db = my->index.size();
-    fc::raw::pack(out, unsigned_int{num_blocks_in_fork_db});
-    for(const auto& s : my->index) {
-        fc::raw::pack(out, *s);
-    }
-    if(my->head)
-        fc::raw::pack(out, my->head->id);
-    else
-        fc::raw::pack(out, block_id_type());
+    my->checkpoint();
+    // blocks pruned below are still kept in the checkpoint
+    my->journal.close();
 
     /// we don't normally indicate the head block as irreversible
     /// we cannot normally prune the lib if it is the head block because
     /// the next block needs to build off of the head block. We are exiting
     /// now so we can prune this block as irreversible before exiting.
     auto lib    = my->head->dpos_irreversible_blocknum;
-    auto oldest = *my->index.get<by_block_num>().begin();
+    auto oldest = my->oldest();
     if(oldest->block_num <= lib) {
         prune(oldest);
     }
 
-    my->index.clear();
+    my->clear();
 }
 
 fork_database::~fork_database() {
@@ -114,12 +386,13 @@ fork_database::~fork_database() {
 
 void
 fork_database::set(block_state_ptr s) {
-    auto result = my->index.insert(s);
     vros_ASSERT(s->id == s->header.id(), fork_database_exception, "block state id (${id}) is different from block state header id (${hid})", ("id", string(s->id))("hid", string(s->header.id())));
 
     // vros_ASSERT( s->block_num == s->header.block_num() );
 
-    vros_ASSERT(result.second, fork_database_exception, "unable to insert block state, duplicate state detected");
+    auto inserted = my->insert(s);
+    vros_ASSERT(inserted, fork_database_exception, "unable to insert block state, duplicate state detected");
+    my->record(journal_op::add, *s);
     if(!my->head) {
         my->head = s;
     }
@@ -130,17 +403,19 @@ fork_database::set(block_state_ptr s) {
 
 block_state_ptr
 fork_database::add(block_state_ptr n) {
-    auto inserted = my->index.insert(n);
-    vros_ASSERT(inserted.second, fork_database_exception, "duplicate block added?");
+    auto inserted = my->insert(n);
+    vros_ASSERT(inserted, fork_database_exception, "duplicate block added?");
+    my->record(journal_op::add, *n);
 
-    my->head = *my->index.get<by_lib_block_num>().begin();
+    my->update_head(n);
 
     auto lib    = my->head->dpos_irreversible_blocknum;
-    auto oldest = *my->index.get<by_block_num>().begin();
+    auto oldest = my->oldest();
 
     if(oldest->block_num < lib) {
         prune(oldest);
     }
+    my->maybe_checkpoint();
 
     return n;
 }
@@ -150,14 +425,12 @@ fork_database::add(signed_block_ptr b, bool trust) {
     vros_ASSERT(b, fork_database_exception, "attempt to add null block");
     vros_ASSERT(my->head, fork_database_exception, "no head block set");
 
-    const auto& by_id_idx = my->index.get<by_block_id>();
-    auto        existing  = by_id_idx.find(b->id());
-    vros_ASSERT(existing == by_id_idx.end(), fork_database_exception, "we already know about this block");
+    vros_ASSERT(my->by_id.find(b->id()) == my->by_id.end(), fork_database_exception, "we already know about this block");
 
-    auto prior = by_id_idx.find(b->previous);
-    vros_ASSERT(prior != by_id_idx.end(), unlinkable_block_exception, "unlinkable block", ("id", b->id())("previous", b->previous));
+    auto prior = my->by_id.find(b->previous);
+    vros_ASSERT(prior != my->by_id.end(), unlinkable_block_exception, "unlinkable block", ("id", b->id())("previous", b->previous));
 
-    auto result = std::make_shared<block_state>(**prior, move(b), trust);
+    auto result = std::make_shared<block_state>(*prior->second, move(b), trust);
     vros_ASSERT(result, fork_database_exception , "fail to add new block state");
     return add(result);
 }
@@ -209,22 +482,27 @@ fork_database::fetch_branch_from(const block_id_type& first, const block_id_type
 /// remove all of the invalid forks built of this id including this id
 void
 fork_database::remove(const block_id_type& id) {
+    my->record(journal_op::remove, id);
+
     vector<block_id_type> remove_queue{id};
 
     for(uint32_t i = 0; i < remove_queue.size(); ++i) {
-        auto itr = my->index.find(remove_queue[i]);
-        if(itr != my->index.end())
-            my->index.erase(itr);
-
-        auto& previdx = my->index.get<by_prev>();
-        auto  previtr = previdx.lower_bound(remove_queue[i]);
-        while(previtr != previdx.end() && (*previtr)->header.previous == remove_queue[i]) {
-            remove_queue.push_back((*previtr)->id);
-            ++previtr;
+        auto itr = my->by_id.find(remove_queue[i]);
+        if(itr != my->by_id.end())
+            my->erase(itr->second);
+
+        // blocks built off this one can only be in the slot of next block number
+        auto next = my->get_slot(block_header::num_from_id(remove_queue[i]) + 1);
+        if(next != nullptr) {
+            for(auto& b : *next) {
+                if(b->header.previous == remove_queue[i]) {
+                    remove_queue.push_back(b->id);
+                }
+            }
         }
     }
-    // wdump((my->index.size()));
-    my->head = *my->index.get<by_lib_block_num>().begin();
+    // wdump((my->size()));
+    my->reset_head();
 }
 
 void
@@ -234,6 +512,9 @@ fork_database::set_validity(const block_state_ptr& h, bool valid) {
     }
     else {
         /// remove older than irreversible and mark block as valid
+        if(!h->validated) {
+            my->record(journal_op::validate, h->id);
+        }
         h->validated = true;
     }
 }
@@ -243,64 +524,59 @@ fork_database::mark_in_current_chain(const block_state_ptr& h, bool in_current_c
     if(h->in_current_chain == in_current_chain)
         return;
 
-    auto& by_id_idx = my->index.get<by_block_id>();
-    auto  itr       = by_id_idx.find(h->id);
-    vros_ASSERT(itr != by_id_idx.end(), fork_db_block_not_found, "could not find block in fork database");
+    auto itr = my->by_id.find(h->id);
+    vros_ASSERT(itr != my->by_id.end(), fork_db_block_not_found, "could not find block in fork database");
 
-    by_id_idx.modify(
-        itr, [&](auto& bsp) {  // Need to modify this way rather than directly so that Boost MultiIndex can re-sort
-            bsp->in_current_chain = in_current_chain;
-        });
+    my->record(journal_op::mark_in_current_chain, std::make_pair(h->id, in_current_chain));
+    itr->second->in_current_chain = in_current_chain;
 }
 
 void
 fork_database::prune(const block_state_ptr& h) {
     auto num = h->block_num;
 
-    auto& by_bn = my->index.get<by_block_num>();
-    auto  bni   = by_bn.begin();
-    while(bni != by_bn.end() && (*bni)->block_num < num) {
-        prune(*bni);
-        bni = by_bn.begin();
+    while(!my->slots.empty() && my->first_num < num) {
+        prune(my->oldest());
     }
 
-    auto itr = my->index.find(h->id);
-    if(itr != my->index.end()) {
-        irreversible(*itr);
-        my->index.erase(itr);
+    auto itr = my->by_id.find(h->id);
+    if(itr != my->by_id.end()) {
+        auto b = itr->second;
+        irreversible(b);
+        my->record(journal_op::erase, h->id);
+        my->erase(b);
     }
 
-    auto& numidx = my->index.get<by_block_num>();
-    auto  nitr   = numidx.lower_bound(num);
-    while(nitr != numidx.end() && (*nitr)->block_num == num) {
-        auto itr_to_remove = nitr;
-        ++nitr;
-        auto id = (*itr_to_remove)->id;
-        remove(id);
+    // the rest blocks of the same number are forks which can never become irreversible
+    if(auto slot = my->get_slot(num)) {
+        auto ids = vector<block_id_type>();
+        for(auto& b : *slot) {
+            ids.emplace_back(b->id);
+        }
+        for(auto& id : ids) {
+            remove(id);
+        }
     }
 }
 
 block_state_ptr
 fork_database::get_block(const block_id_type& id) const {
-    auto itr = my->index.find(id);
-    if(itr != my->index.end())
-        return *itr;
+    auto itr = my->by_id.find(id);
+    if(itr != my->by_id.end())
+        return itr->second;
     return block_state_ptr();
 }
 
 block_state_ptr
 fork_database::get_block_in_current_chain_by_num(uint32_t n) const {
-    const auto& numidx = my->index.get<by_block_num>();
-    auto        nitr   = numidx.lower_bound(n);
-    // following asserts removed so null can be returned
-    // vros_ASSERT( nitr != numidx.end() && (*nitr)->block_num == n,
-    //           "could not find block in fork database with block number ${block_num}", ("block_num", n) );
-    // vros_ASSERT( (*nitr)->in_current_chain == true,
-    //           "block (with block number ${block_num}) found in fork database is not in the current chain",
-    //           ("block_num", n) );
-    if(nitr == numidx.end() || (*nitr)->block_num != n || (*nitr)->in_current_chain != true)
+    auto slot = my->get_slot(n);
+    if(slot == nullptr)
         return block_state_ptr();
-    return *nitr;
+    for(auto& b : *slot) {
+        if(b->in_current_chain)
+            return b;
+    }
+    return block_state_ptr();
 }
 
 void
@@ -308,9 +584,10 @@ fork_database::add(const header_confirmation& c) {
     auto b = get_block(c.block_id);
     vros_ASSERT(b, fork_db_block_not_found, "unable to find block id ${id}", ("id", c.block_id));
     b->add_confirmation(c);
+    my->record(journal_op::confirm, c);
 
     if(b->bft_irreversible_blocknum < b->block_num
-       && b->confirmations.size() > ((b->active_schedule.producers.size() * 2) / 3)) {
+       && b->confirmations.size() > ((b->active_schedule->producers.size() * 2) / 3)) {
         set_bft_irreversible(c.block_id);
     }
 }
@@ -324,10 +601,9 @@ fork_database::add(const header_confirmation& c) {
  */
 void
 fork_database::set_bft_irreversible(block_id_type id) {
-    auto&    idx       = my->index.get<by_block_id>();
-    auto     itr       = idx.find(id);
-    uint32_t block_num = (*itr)->block_num;
-    idx.modify(itr, [&](auto& bsp) { bsp->bft_irreversible_blocknum = bsp->block_num; });
+    auto     b         = my->by_id.find(id)->second;
+    uint32_t block_num = b->block_num;
+    b->bft_irreversible_blocknum = block_num;
 
     /** to prevent stack-overflow, we perform a bredth-first traversal of the
      * fork database. At each stage we iterate over the leafs from the prior stage
@@ -339,17 +615,15 @@ fork_database::set_bft_irreversible(block_id_type id) {
         vector<block_id_type> updated;
 
         for(const auto& i : in) {
-            auto& pidx  = my->index.get<by_prev>();
-            auto  pitr  = pidx.lower_bound(i);
-            auto  epitr = pidx.upper_bound(i);
-            while(pitr != epitr) {
-                pidx.modify(pitr, [&](auto& bsp) {
-                    if(bsp->bft_irreversible_blocknum < block_num) {
-                        bsp->bft_irreversible_blocknum = block_num;
-                        updated.push_back(bsp->id);
-                    }
-                });
-                ++pitr;
+            auto next = my->get_slot(block_header::num_from_id(i) + 1);
+            if(next == nullptr) {
+                continue;
+            }
+            for(auto& bsp : *next) {
+                if(bsp->header.previous == i && bsp->bft_irreversible_blocknum < block_num) {
+                    bsp->bft_irreversible_blocknum = block_num;
+                    updated.push_back(bsp->id);
+                }
             }
         }
         return updated;
@@ -359,6 +633,7 @@ fork_database::set_bft_irreversible(block_id_type id) {
     while(queue.size()) {
         queue = update(queue);
     }
+    my->reset_head();
 }
 
 }}  // namespace vros::chain
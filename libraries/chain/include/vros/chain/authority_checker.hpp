@@ -3,7 +3,9 @@
  *  @copyright defined in vros/LICENSE.txt
  */
 #pragma once
+#include <algorithm>
 #include <functional>
+#include <map>
 
 #include <vros/chain/controller.hpp>
 #include <vros/chain/config.hpp>
@@ -12,13 +14,9 @@
 #include <vros/chain/token_database.hpp>
 #include <vros/chain/types.hpp>
 #include <vros/chain/producer_schedule.hpp>
-#include <vros/utilities/parallel_markers.hpp>
 
 #include <fc/scoped_exit.hpp>
 
-#include <boost/algorithm/cxx11/all_of.hpp>
-#include <boost/range/algorithm/find.hpp>
-
 namespace vros { namespace chain {
 
 class authority_checker;
@@ -42,9 +40,19 @@ class authority_checker {
 private:
     const controller&                control_;
     const flat_set<public_key_type>& signing_keys_;
-    const token_database&            token_db_;
+    const token_database*            token_db_;
+    const token_database_snapshot*   token_snapshot_;
     const uint32_t                   max_recursion_depth_;
-    vector<bool>                     used_keys_;
+    vector<uint64_t>                 used_keys_;    // bitset of slots in signing keys
+    vector<uint32_t>                 newly_used_;   // slots first used by current action, reverted if it's not satisfied
+
+    // objects resolved by this checker, actions of one transaction usually share them
+    // they cannot be changed during checking, cross-transaction reuse is left to token database cache
+    std::map<domain_name, domain_def>                    domains_;
+    std::map<symbol_id_type, fungible_def>               fungibles_;
+    std::map<group_name, group_def>                      groups_;
+    std::map<std::pair<domain_name, name128>, token_def> tokens_;
+    std::vector<proposal_name>                           suspends_;  // suspends are read each time, only names are kept
 
 public:
     struct weight_tally_visitor {
@@ -68,9 +76,9 @@ public:
 
         uint32_t
         operator()(const public_key_type& key, const weight_type weight) {
-            auto itr = boost::find(checker_->signing_keys_, key);
-            if(itr != checker_->signing_keys_.end()) {
-                checker_->used_keys_[itr - checker_->signing_keys_.begin()] = true;
+            auto slot = checker_->find_slot(key);
+            if(slot >= 0) {
+                checker_->mark_used(slot);
                 total_weight_ += weight;
             }
             return total_weight_;
@@ -92,15 +100,85 @@ public:
     authority_checker(const controller& control, const flat_set<public_key_type>& signing_keys, const token_database& token_db, uint32_t max_recursion_depth)
         : control_(control)
         , signing_keys_(signing_keys)
-        , token_db_(token_db)
+        , token_db_(&token_db)
+        , token_snapshot_(nullptr)
         , max_recursion_depth_(max_recursion_depth)
-        , used_keys_(signing_keys.size(), false) {}
+        , used_keys_((signing_keys.size() + 63) / 64, 0) {}
+
+    // checks against a snapshot of token database, can be used concurrently from other threads
+    authority_checker(const controller& control, const flat_set<public_key_type>& signing_keys, const token_database_snapshot& token_snapshot, uint32_t max_recursion_depth)
+        : control_(control)
+        , signing_keys_(signing_keys)
+        , token_db_(nullptr)
+        , token_snapshot_(&token_snapshot)
+        , max_recursion_depth_(max_recursion_depth)
+        , used_keys_((signing_keys.size() + 63) / 64, 0) {}
+
+private:
+    // signing keys are sorted, slot of one key is its position found by binary search
+    int
+    find_slot(const public_key_type& key) const {
+        auto it = signing_keys_.find(key);
+        if(it == signing_keys_.end()) {
+            return -1;
+        }
+        return it - signing_keys_.begin();
+    }
+
+    bool
+    is_used(uint32_t slot) const {
+        return (used_keys_[slot / 64] >> (slot % 64)) & 1;
+    }
+
+    void
+    mark_used(uint32_t slot) {
+        if(!is_used(slot)) {
+            used_keys_[slot / 64] |= (uint64_t)1 << (slot % 64);
+            newly_used_.emplace_back(slot);
+        }
+    }
+
+    flat_set<public_key_type>
+    filter_keys(bool used) const {
+        auto keys = flat_set<public_key_type>();
+        keys.reserve(signing_keys_.size());
+        auto i = 0u;
+        for(auto& key : signing_keys_) {
+            if(is_used(i++) == used) {
+                keys.emplace_hint(keys.end(), key);
+            }
+        }
+        return keys;
+    }
 
 private:
+    template<typename Func>
+    void
+    read_token_db(Func&& f) {
+        if(token_snapshot_ != nullptr) {
+            f(*token_snapshot_);
+        }
+        else {
+            f(*token_db_);
+        }
+    }
+
+private:
+    template<typename K, typename T, typename Func>
+    const T&
+    resolve(std::map<K, T>& memo, const K& key, Func&& load) {
+        auto it = memo.find(key);
+        if(it != memo.end()) {
+            return it->second;
+        }
+        auto v = T();
+        read_token_db([&](const auto& db) { load(db, v); });
+        return memo.emplace(key, std::move(v)).first->second;
+    }
+
     void
     get_domain_permission(const domain_name& domain_name, const permission_name name, std::function<void(const permission_def&)>&& cb) {
-        domain_def domain;
-        token_db_.read_domain(domain_name, domain);
+        auto& domain = resolve(domains_, domain_name, [&](const auto& db, auto& v) { db.read_domain(domain_name, v); });
         if(name == N(issue)) {
             cb(domain.issue);
         }
@@ -114,8 +192,7 @@ private:
 
     void
     get_fungible_permission(const symbol_id_type sym_id, const permission_name name, std::function<void(const permission_def&)>&& cb) {
-        fungible_def fungible;
-        token_db_.read_fungible(sym_id, fungible);
+        auto& fungible = resolve(fungibles_, sym_id, [&](const auto& db, auto& v) { db.read_fungible(sym_id, v); });
         if(name == N(issue)) {
             cb(fungible.issue);
         }
@@ -126,22 +203,22 @@ private:
 
     void
     get_group(const group_name& name, std::function<void(const group_def&)>&& cb) {
-        group_def group;
-        token_db_.read_group(name, group);
+        auto& group = resolve(groups_, name, [&](const auto& db, auto& v) { db.read_group(name, v); });
         cb(group);
     }
 
     void
     get_owner(const domain_name& domain, const name128& name, std::function<void(const address_list&)>&& cb) {
-        token_def token;
-        token_db_.read_token(domain, name, token);
+        auto& token = resolve(tokens_, std::make_pair(domain, name), [&](const auto& db, auto& v) { db.read_token(domain, name, v); });
         cb(token.owner);
     }
 
     void
     get_suspend(const proposal_name& proposal, std::function<void(const suspend_def&)>&& cb) {
+        suspends_.emplace_back(proposal);
+
         suspend_def suspend;
-        token_db_.read_suspend(proposal, suspend);
+        read_token_db([&](const auto& db) { db.read_suspend(proposal, suspend); });
         cb(suspend);
     }
 
@@ -158,32 +235,99 @@ private:
     } 
 
 private:
+    // signing keys present in one group, indexed by key slots of the group
+    struct group_keys {
+        std::vector<uint64_t> present;  // bitset of slots
+        std::vector<int>      signing;  // index in signing keys of each slot, -1 if not signed
+    };
+
+    void
+    mark_used(const group_keys& gkeys, uint32_t slot) {
+        mark_used(gkeys.signing[slot]);
+    }
+
     bool
-    satisfied_node(const group& group, const group::node& node, uint32_t depth) {
+    is_present(const group_keys& gkeys, uint32_t slot) const {
+        return (gkeys.present[slot / 64] >> (slot % 64)) & 1;
+    }
+
+    uint32_t
+    count_present(const group_keys& gkeys, uint32_t begin, uint32_t end) const {
+        auto count = 0u;
+        while(begin < end) {
+            auto bits = gkeys.present[begin / 64] >> (begin % 64);
+            auto n    = std::min(64 - begin % 64, end - begin);
+            if(n < 64) {
+                bits &= ((uint64_t)1 << n) - 1;
+            }
+            count += __builtin_popcountll(bits);
+            begin += n;
+        }
+        return count;
+    }
+
+    bool
+    satisfied_op(const group::program& prog, const group::program::op& op, const group_keys& gkeys, uint32_t depth) {
         FC_ASSERT(depth < max_recursion_depth_);
-        FC_ASSERT(!node.is_leaf());
-        auto vistor = weight_tally_visitor(this);
-        group.visit_node(node, [&](const auto& n) {
-            FC_ASSERT(!n.is_root());
-            if(n.is_leaf()) {
-                vistor(group.get_leaf_key(n), n.weight);
+        FC_ASSERT(!op.leaf);
+
+        if(op.uniform) {
+            // children are leaves with the same weight and their keys are contiguous slots
+            auto& first  = prog.ops[op.index];
+            auto  begin  = (uint32_t)first.index;
+            auto  end    = begin + op.size;
+            auto  weight = (uint32_t)first.weight;
+            auto  count  = count_present(gkeys, begin, end);
+
+            // same keys as visiting children in order until threshold is reached
+            auto need = (op.threshold + weight - 1) / weight;
+            auto used = std::min(count, need);
+            for(auto slot = begin; used > 0; slot++) {
+                if(is_present(gkeys, slot)) {
+                    mark_used(gkeys, slot);
+                    used--;
+                }
             }
-            else {
-                if(satisfied_node(group, n, depth + 1)) {
-                    vistor.add_weight(n.weight);
+            return (uint64_t)count * weight >= op.threshold;
+        }
+
+        auto total_weight = 0u;
+        for(auto i = 0u; i < op.size; i++) {
+            auto& c = prog.ops[op.index + i];
+            if(c.leaf) {
+                if(is_present(gkeys, c.index)) {
+                    mark_used(gkeys, c.index);
+                    total_weight += c.weight;
                 }
             }
-            if(vistor.total_weight() >= node.threshold) {
-                return false;  // no need to visit more nodes
+            else if(satisfied_op(prog, c, gkeys, depth + 1)) {
+                total_weight += c.weight;
+            }
+            if(total_weight >= op.threshold) {
+                return true;
             }
-            return true;
-        });
-        if(vistor.total_weight() >= node.threshold) {
-            return true;
         }
         return false;
     }
 
+    bool
+    satisfied_group(const group& group) {
+        auto& prog = group.compiled();
+        auto& keys = group.keys_;
+
+        auto gkeys = group_keys();
+        gkeys.present.resize((keys.size() + 63) / 64);
+        gkeys.signing.resize(keys.size(), -1);
+        for(auto i = 0u; i < keys.size(); i++) {
+            auto slot = find_slot(keys[i]);
+            if(slot >= 0) {
+                gkeys.present[i / 64] |= (uint64_t)1 << (i % 64);
+                gkeys.signing[i] = slot;
+            }
+        }
+        return satisfied_op(prog, prog.ops[0], gkeys, 0);
+    }
+
     bool
     satisfied_permission(const permission_def& permission, const action& action) {
         uint32_t total_weight = 0;
@@ -215,7 +359,7 @@ private:
             case authorizer_ref::group_t: {
                 auto& name = ref.get_group();
                 get_group(name, [&](const auto& group) {
-                    if(satisfied_node(group, group.root(), 0)) {
+                    if(satisfied_group(group)) {
                         ref_result = true;
                     }
                 });
@@ -256,9 +400,12 @@ public:
     satisfied(const action& act) {
         using namespace __internal;
 
-        // Save the current used keys; if we do not satisfy this authority, the newly used keys aren't actually used
-        auto KeyReverter = fc::make_scoped_exit([this, keys = used_keys_]() mutable {
-            used_keys_ = keys;
+        // Track the newly used keys; if we do not satisfy this authority, they aren't actually used
+        newly_used_.clear();
+        auto KeyReverter = fc::make_scoped_exit([this]() {
+            for(auto slot : newly_used_) {
+                used_keys_[slot / 64] &= ~((uint64_t)1 << (slot % 64));
+            }
         });
 
         bool result = types_invoker<bool, check_authority>::invoke(act.name, act, this);
@@ -271,18 +418,36 @@ public:
     }
 
     bool
-    all_keys_used() const { return boost::algorithm::all_of_equal(used_keys_, true); }
-
-    flat_set<public_key_type>
-    used_keys() const {
-        auto range = utilities::filter_data_by_marker(signing_keys_, used_keys_, true);
-        return range;
+    all_keys_used() const {
+        for(auto i = 0u; i < signing_keys_.size(); i++) {
+            if(!is_used(i)) {
+                return false;
+            }
+        }
+        return true;
     }
 
-    flat_set<public_key_type>
-    unused_keys() const {
-        auto range = utilities::filter_data_by_marker(signing_keys_, used_keys_, false);
-        return range;
+    flat_set<public_key_type> used_keys() const { return filter_keys(true); }
+    flat_set<public_key_type> unused_keys() const { return filter_keys(false); }
+
+    // objects of token database read by the checks so far, results only hold while none of them is changed
+    token_read_set
+    read_set() const {
+        auto reads = token_read_set();
+        for(auto& d : domains_) {
+            reads.domains.emplace_back(d.first);
+        }
+        for(auto& f : fungibles_) {
+            reads.fungibles.emplace_back(f.first);
+        }
+        for(auto& g : groups_) {
+            reads.groups.emplace_back(g.first);
+        }
+        for(auto& t : tokens_) {
+            reads.tokens.emplace_back(t.first);
+        }
+        reads.suspends = suspends_;
+        return reads;
     }
 };  /// authority_checker
 
@@ -526,7 +691,7 @@ struct check_authority<addmeta> {
             case authorizer_ref::group_t: {
                 auto& name = ref.get_group();
                 checker->get_group(name, [&](const auto& group) {
-                    if(checker->satisfied_node(group, group.root(), 0)) {
+                    if(checker->satisfied_group(group)) {
                         ref_result = true;
                     }
                 });
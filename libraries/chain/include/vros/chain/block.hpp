@@ -47,10 +47,16 @@ struct transaction_receipt : public transaction_receipt_header {
 
     digest_type
     digest() const {
+        return digest(trx.packed_digest());
+    }
+
+    // same as `digest()` with `trx.packed_digest()` computed beforehand
+    digest_type
+    digest(const digest_type& packed_digest) const {
         digest_type::encoder enc;
         fc::raw::pack(enc, status);
         fc::raw::pack(enc, type);
-        fc::raw::pack(enc, trx.packed_digest());
+        fc::raw::pack(enc, packed_digest);
         return enc.result();
     }
 };
@@ -4,13 +4,19 @@
  */
 #pragma once
 #include <vros/chain/block_header.hpp>
+#include <vros/chain/copy_on_write.hpp>
 #include <vros/chain/incremental_merkle.hpp>
 
 namespace vros { namespace chain {
 
+using cow_producer_schedule = copy_on_write<producer_schedule_type>;
+
 /**
  *  @struct block_header_state
  *  @brief defines the minimum state necessary to validate transaction headers
+ *
+ *  Producer schedules rarely change, so they are shared by consecutive states
+ *  instead of being copied into every new one.
  */
 struct block_header_state {
     block_id_type                    id;
@@ -21,8 +27,8 @@ struct block_header_state {
     uint32_t                         bft_irreversible_blocknum  = 0;
     uint32_t                         pending_schedule_lib_num   = 0;  /// last irr block num
     digest_type                      pending_schedule_hash;
-    producer_schedule_type           pending_schedule;
-    producer_schedule_type           active_schedule;
+    cow_producer_schedule            pending_schedule;
+    cow_producer_schedule            active_schedule;
     incremental_merkle               blockroot_merkle;
     flat_map<account_name, uint32_t> producer_to_last_produced;
     flat_map<account_name, uint32_t> producer_to_last_implied_irb;
@@ -40,7 +46,7 @@ struct block_header_state {
 
     bool
     has_pending_producers() const {
-        return pending_schedule.producers.size();
+        return pending_schedule->producers.size();
     }
 
     uint32_t calc_dpos_last_irreversible() const;
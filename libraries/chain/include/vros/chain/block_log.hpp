@@ -34,13 +34,39 @@ class block_log_impl;
  * Blocks can be accessed at random via block number through the index file. Seek to 8 * (block_num - 1)
  * to find the position of the block in the main file.
  *
+ * Above is the layout of version 1. Since version 2 blocks are grouped into chunks, and each chunk takes the
+ * place of a block in the layout above:
+ *
+ * +--------------+----------------------------------+---------------------------------+----------------+
+ * | Chunk header | Offsets of blocks in raw payload | Payload (zlib compressed or not) | Pos of Chunk   |
+ * +--------------+----------------------------------+---------------------------------+----------------+
+ *
+ * The index file keeps one entry per block, it's the position of the chunk holding the block. So a lookup
+ * takes two levels, the index gives the chunk and the offsets in the chunk give the block. Blocks appended
+ * by a running node are collected into a pending chunk, which is written into the log once it holds 256 blocks
+ * or 4MB. Until then its blocks are kept in memory and in blocks.pending, one length-prefixed block after
+ * another, so they survive a restart. `convert_log` regroups an existing log (of any supported version) into
+ * chunks offline. Logs of version 1 are still read and appended as they are.
+ *
+ * Logs of version 2 can retain only the most recent blocks. Once there are a quarter more blocks than
+ * retained, chunks of retained blocks are copied after the genesis into new files replacing current ones.
+ * The first chunk tells the first block in log and the index starts from that block.
+ *
  * The main file is the only file that needs to persist. The index file can be reconstructed during a
  * linear scan of the main file.
+ *
+ * Both files are written through append-only streams and read through read-only memory mappings,
+ * index lookups are plain memory reads and blocks are decoded straight from the mapped file.
+ *
+ * Reading methods (`read_block_by_num`, `read_block_by_id`, `get_block_pos`, `first_block_num` and
+ * `read_head`) can be called from any number of threads at the same time, also while blocks are appended
+ * by the writing thread.
+ * Other methods, including `head`, belong to the writing thread.
  */
 
 class block_log {
 public:
-    block_log(const fc::path& data_dir);
+    block_log(const fc::path& data_dir, uint32_t retain_blocks = 0);
     block_log(block_log&& other);
     ~block_log();
 
@@ -48,8 +74,10 @@ public:
     void     flush();
     uint64_t reset_to_genesis(const genesis_state& gs, const signed_block_ptr& genesis_block);
 
-    std::pair<signed_block_ptr, uint64_t> read_block(uint64_t file_pos) const;
-    signed_block_ptr                      read_block_by_num(uint32_t block_num) const;
+    /**
+     * Return the block, or empty pointer if it's after head block or pruned (before `first_block_num`).
+     */
+    signed_block_ptr read_block_by_num(uint32_t block_num) const;
 
     signed_block_ptr
     read_block_by_id(const block_id_type& id) const {
@@ -57,17 +85,20 @@ public:
     }
 
     /**
-     * Return offset of block in file, or block_log::npos if it does not exist.
+     * Return offset of block (or of the chunk holding it since version 2) in file, or block_log::npos if it does not exist.
      */
     uint64_t                get_block_pos(uint32_t block_num) const;
+    uint32_t                first_block_num() const;
     signed_block_ptr        read_head() const;
     const signed_block_ptr& head() const;
 
     static const uint64_t npos = std::numeric_limits<uint64_t>::max();
 
+    static const uint32_t min_supported_version;
     static const uint32_t supported_version;
 
     static fc::path repair_log(const fc::path& data_dir, uint32_t truncate_at_block = 0);
+    static fc::path convert_log(const fc::path& data_dir, uint32_t blocks_per_chunk = 256);
 
     static genesis_state extract_genesis_state(const fc::path& data_dir);
 
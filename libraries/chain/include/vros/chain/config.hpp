@@ -16,11 +16,16 @@ typedef __uint128_t uint128_t;
 const static auto default_blocks_dir_name       = "blocks";
 const static auto reversible_blocks_dir_name    = "reversible";
 const static auto default_tokendb_dir_name      = "tokendb";
+const static auto default_tokendb_cache_size    = 4096; /// number of decoded objects kept in token database cache
+const static auto default_controller_thread_pool_size = 2; /// number of threads used for validating transactions of blocks
+const static auto default_sigs_cache_size       = 64*1024; /// number of public keys recovered from signatures kept in cache
+const static auto default_replay_read_ahead_blocks = 64; /// number of blocks decoded ahead of the one being applied when replaying block log
 const static auto default_reversible_cache_size = 340*1024*1024ll;/// 1MB * 340 blocks based on 21 producer BFT delay
 const static auto default_reversible_guard_size = 2*1024*1024ll;/// 1MB * 2 blocks based on 21 producer BFT delay
 
 const static auto default_state_dir_name        = "state";
 const static auto forkdb_filename               = "forkdb.dat";
+const static auto forkdb_journal_filename       = "forkdb.log";
 const static auto default_state_size            = 1*1024*1024*1024ll;
 const static auto default_state_guard_size      = 128*1024*1024ll;
 
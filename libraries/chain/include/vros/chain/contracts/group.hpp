@@ -6,6 +6,7 @@
 
 #include <string>
 #include <functional>
+#include <memory>
 #include <fc/reflect/reflect.hpp>
 #include <vros/chain/types.hpp>
 #include <vros/chain/address.hpp>
@@ -40,6 +41,24 @@ public:
 
     using visit_func = std::function<bool(const node&)>;
 
+    /**
+     * Flat evaluation program compiled from the nodes, it has the same layout as `nodes_`.
+     * Nodes whose children are all leaves with the same weight are marked as uniform,
+     * their leaf keys are a contiguous range of key slots so that they can be counted by popcount.
+     */
+    struct program {
+        struct op {
+            weight_type weight;
+            weight_type threshold;
+            uint16_t    index;      // child op index for non-leaf, key slot for leaf
+            uint16_t    size;
+            bool        leaf;
+            bool        uniform;    // all the children are leaves with the same weight
+        };
+
+        std::vector<op> ops;
+    };
+
 public:
     const group_name& name() const { return name_; }
     const address& key() const { return key_; }
@@ -51,6 +70,12 @@ public:
     void visit_root(const visit_func&) const;
     void visit_node(const node&, const visit_func&) const;
 
+public:
+    // compiles the program from current nodes, needs to be called again if nodes are changed
+    void compile() const;
+    // returns the compiled program, compiles it first if it's not compiled
+    const program& compiled() const;
+
 public:
     const public_key_type&
     get_leaf_key(const node& n) const {
@@ -71,6 +96,10 @@ public:
     std::vector<node>               nodes_;
     std::vector<public_key_type>    keys_;
     meta_list                       metas_;
+
+private:
+    // not serialized, copies of one group share the same program
+    mutable std::shared_ptr<const program> program_;
 };
 
 }}}  // namespac vros::chain::contracts
@@ -4,6 +4,7 @@
  */
 #pragma once
 #include <functional>
+#include <future>
 #include <boost/signals2/signal.hpp>
 #include <vros/chain/block_state.hpp>
 #include <vros/chain/trace.hpp>
@@ -39,6 +40,10 @@ public:
         uint64_t state_guard_size       = chain::config::default_state_guard_size;
         uint64_t reversible_cache_size  = chain::config::default_reversible_cache_size;
         uint64_t reversible_guard_size  = chain::config::default_reversible_guard_size;
+        uint32_t tokendb_cache_size     = chain::config::default_tokendb_cache_size;
+        uint16_t thread_pool_size       = chain::config::default_controller_thread_pool_size;
+        uint32_t sigs_cache_size        = chain::config::default_sigs_cache_size;
+        uint32_t blocks_retain_size     = 0;  ///< number of most recent blocks kept in block log, zero to keep all
         bool     read_only              = false;
         bool     force_all_checks       = false;
         bool     loadtest_mode          = false;
@@ -80,6 +85,13 @@ public:
     vector<transaction_metadata_ptr> get_unapplied_transactions() const;
     void                             drop_unapplied_transaction(const transaction_metadata_ptr& trx);
 
+    /**
+          *  Unpacks the transaction and recovers its signing keys in the controller thread pool.
+          *  The returned metadata is ready to be passed to push_transaction, which then doesn't
+          *  need to do any signature recovery on the calling thread.
+          */
+    std::future<transaction_metadata_ptr> prepare_transaction(const packed_transaction& trx);
+
     transaction_trace_ptr push_transaction(const transaction_metadata_ptr& trx, fc::time_point deadline);
     transaction_trace_ptr push_suspend_transaction(const transaction_metadata_ptr& trx, fc::time_point deadline);
 
@@ -152,6 +164,7 @@ public:
     void    set_chain_config(const chain_config&);
 
     bool skip_auth_check() const;
+    bool skip_trx_checks() const;
     bool loadtest_mode() const;
     bool charge_free_mode() const;
     bool contracts_console() const;
@@ -190,4 +203,4 @@ private:
 }}  // namespace vros::chain
 
 FC_REFLECT(vros::chain::controller::config,
-           (blocks_dir)(state_dir)(tokendb_dir)(state_size)(reversible_cache_size)(read_only)(force_all_checks)(loadtest_mode)(charge_free_mode)(contracts_console)(genesis))
+           (blocks_dir)(state_dir)(tokendb_dir)(state_size)(reversible_cache_size)(tokendb_cache_size)(thread_pool_size)(sigs_cache_size)(blocks_retain_size)(read_only)(force_all_checks)(loadtest_mode)(charge_free_mode)(contracts_console)(genesis))
@@ -0,0 +1,109 @@
+/**
+ *  @file
+ *  @copyright defined in vros/LICENSE.txt
+ */
+#pragma once
+#include <memory>
+#include <utility>
+#include <fc/io/raw.hpp>
+#include <fc/variant.hpp>
+
+namespace vros { namespace chain {
+
+/**
+ * Immutable value shared between copies.
+ *
+ * Copying only copies the pointer, assigning a new value replaces it in this copy and leaves others untouched.
+ * Empty instance stands for a default constructed value and doesn't allocate.
+ */
+template<typename T>
+class copy_on_write {
+public:
+    copy_on_write() = default;
+    copy_on_write(const T& v) : ptr_(std::make_shared<T>(v)) {}
+    copy_on_write(T&& v) : ptr_(std::make_shared<T>(std::move(v))) {}
+
+    copy_on_write(const copy_on_write&) = default;
+    copy_on_write(copy_on_write&& other) noexcept : ptr_(std::move(other.ptr_)) {}
+
+    copy_on_write& operator=(const copy_on_write&) = default;
+
+    copy_on_write&
+    operator=(copy_on_write&& other) noexcept {
+        ptr_ = std::move(other.ptr_);
+        return *this;
+    }
+
+    copy_on_write&
+    operator=(const T& v) {
+        ptr_ = std::make_shared<T>(v);
+        return *this;
+    }
+
+    copy_on_write&
+    operator=(T&& v) {
+        ptr_ = std::make_shared<T>(std::move(v));
+        return *this;
+    }
+
+public:
+    const T&
+    get() const {
+        static const T empty;
+        return ptr_ ? *ptr_ : empty;
+    }
+
+    operator const T&() const { return get(); }
+    const T& operator*() const { return get(); }
+    const T* operator->() const { return &get(); }
+
+    bool operator==(const copy_on_write& rhs) const { return ptr_ == rhs.ptr_ || get() == rhs.get(); }
+    bool operator!=(const copy_on_write& rhs) const { return !(*this == rhs); }
+
+private:
+    std::shared_ptr<T> ptr_;
+};
+
+}}  // namespace vros::chain
+
+namespace fc {
+
+template<typename T>
+void
+to_variant(const vros::chain::copy_on_write<T>& v, fc::variant& var) {
+    to_variant(v.get(), var);
+}
+
+template<typename T>
+void
+from_variant(const fc::variant& var, vros::chain::copy_on_write<T>& v) {
+    auto t = T();
+    from_variant(var, t);
+    v = std::move(t);
+}
+
+namespace raw {
+
+template<typename T>
+struct packer<vros::chain::copy_on_write<T>> {
+    template<typename Stream>
+    static void
+    pack(Stream& out, const vros::chain::copy_on_write<T>& v) {
+        fc::raw::pack(out, v.get());
+    }
+};
+
+template<typename T>
+struct unpacker<vros::chain::copy_on_write<T>> {
+    template<typename Stream>
+    static void
+    unpack(Stream& in, vros::chain::copy_on_write<T>& v) {
+        auto t = T();
+        fc::raw::unpack(in, t);
+        v = std::move(t);
+    }
+};
+
+}  // namespace raw
+
+}  // namespace fc
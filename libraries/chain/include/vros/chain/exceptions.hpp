@@ -136,6 +136,7 @@ FC_DECLARE_DERIVED_EXCEPTION( block_log_unsupported_version,     block_log_excep
 FC_DECLARE_DERIVED_EXCEPTION( block_log_append_fail,             block_log_exception, 3060002, "fail to append block to the block log" );
 FC_DECLARE_DERIVED_EXCEPTION( block_log_not_found,               block_log_exception, 3060003, "block log can not be found" );
 FC_DECLARE_DERIVED_EXCEPTION( block_log_backup_dir_exist,        block_log_exception, 3060004, "block log backup dir already exists" );
+FC_DECLARE_DERIVED_EXCEPTION( block_log_pruned,                  block_log_exception, 3060005, "block is pruned from the block log" );
 
 FC_DECLARE_DERIVED_EXCEPTION( fork_db_block_not_found,           fork_database_exception, 3080001, "Block can not be found" );
 
@@ -267,6 +268,7 @@ FC_DECLARE_DERIVED_EXCEPTION( tokendb_db_action_exception,       tokendb_excepti
 FC_DECLARE_DERIVED_EXCEPTION( tokendb_dirty_flag_exception,      tokendb_exception, 3150017, "Checkspoints log file is in dirty." );
 FC_DECLARE_DERIVED_EXCEPTION( tokendb_squash_exception,          tokendb_exception, 3150018, "Cannot perform squash operation now" );
 FC_DECLARE_DERIVED_EXCEPTION( tokendb_prodvote_not_found,        tokendb_exception, 3150019, "Not found specific producer vote" );
+FC_DECLARE_DERIVED_EXCEPTION( tokendb_staging_exception,         tokendb_exception, 3150020, "Invalid operation on staging session" );
 
 FC_DECLARE_DERIVED_EXCEPTION( unknown_block_exception,           misc_exception, 3100002, "unknown block" );
 FC_DECLARE_DERIVED_EXCEPTION( unknown_transaction_exception,     misc_exception, 3100003, "unknown transaction" );
@@ -22,6 +22,10 @@ typedef vector<block_state_ptr> branch_type;
  * database tracks the longest chain and the last irreversible block number. All
  * blocks older than the last irreversible block are freed after emitting the
  * irreversible signal.
+ *
+ * Every change is appended to a journal as it happens and the journal is compacted
+ * into a checkpoint of all the block states once it grows large, so the state
+ * survives an unclean shutdown and closing doesn't need to serialize everything.
  */
 class fork_database {
 public:
@@ -73,6 +77,7 @@ public:
 
 private:
     void                           set_bft_irreversible(block_id_type id);
+    uint32_t                       replay_journal(const fc::path& journal_file);
     unique_ptr<fork_database_impl> my;
 };
 
@@ -182,13 +182,58 @@ public:
        */
     const DigestType&
     append(const DigestType& digest) {
+        auto updated_active_nodes = vector<DigestType>();
+        collapse(digest, updated_active_nodes);
+
+        // store the new active_nodes
+        detail::move_nodes(_active_nodes, std::move(updated_active_nodes));
+
+        // update the node count
+        _node_count++;
+
+        return _active_nodes.back();
+    }
+
+    /**
+     * Returns a new tree with the node appended and leaves this one untouched.
+     *
+     * Unlike copying the tree and then appending to the copy, the active nodes are
+     * only built once.
+     */
+    incremental_merkle_impl
+    appended(const DigestType& digest) const {
+        auto result = incremental_merkle_impl();
+        collapse(digest, result._active_nodes);
+        result._node_count = _node_count + 1;
+        return result;
+    }
+
+    /**l
+       * return the current root of the incremental merkle
+       *
+       * @return
+       */
+    DigestType
+    get_root() const {
+        if(_node_count > 0) {
+            return _active_nodes.back();
+        }
+        else {
+            return DigestType();
+        }
+    }
+
+private:
+    // builds active nodes of the tree after appending `digest` into `updated_active_nodes`
+    template<typename Nodes>
+    void
+    collapse(const DigestType& digest, Nodes& updated_active_nodes) const {
         bool partial              = false;
         auto max_depth            = detail::calcluate_max_depth(_node_count + 1);
         auto current_depth        = max_depth - 1;
         auto index                = _node_count;
         auto top                  = digest;
         auto active_iter          = _active_nodes.begin();
-        auto updated_active_nodes = vector<DigestType>();
         updated_active_nodes.reserve(max_depth);
 
         while(current_depth > 0) {
@@ -204,7 +249,7 @@ public:
 
                 // calculate the partially realized node value by implying the "right" value is identical
                 // to the "left" value
-                top     = DigestType::hash(make_canonical_pair(top, top));
+                top     = hash_pair(top, top);
                 partial = true;
             }
             else {
@@ -221,7 +266,7 @@ public:
                 }
 
                 // calculate the node
-                top = DigestType::hash(make_canonical_pair(left_value, top));
+                top = hash_pair(left_value, top);
             }
 
             // move up a level in the tree
@@ -231,29 +276,6 @@ public:
 
         // append the top of the collapsed tree (aka the root of the merkle)
         updated_active_nodes.emplace_back(top);
-
-        // store the new active_nodes
-        detail::move_nodes(_active_nodes, std::move(updated_active_nodes));
-
-        // update the node count
-        _node_count++;
-
-        return _active_nodes.back();
-    }
-
-    /**l
-       * return the current root of the incremental merkle
-       *
-       * @return
-       */
-    DigestType
-    get_root() const {
-        if(_node_count > 0) {
-            return _active_nodes.back();
-        }
-        else {
-            return DigestType();
-        }
     }
 
 public:
@@ -18,6 +18,11 @@ namespace vros { namespace chain {
       return make_pair(make_canonical_left(l), make_canonical_right(r));
    };
 
+   /**
+    *  Hashes the canonical pair of `l` and `r`, same as digest_type::hash(make_canonical_pair(l, r)) without packing the pair.
+    */
+   digest_type hash_pair(const digest_type& l, const digest_type& r);
+
    /**
     *  Calculates the merkle root of a set of digests, if ids is odd it will duplicate the last id.
     */
@@ -0,0 +1,76 @@
+/**
+ *  @file
+ *  @copyright defined in vros/LICENSE.txt
+ */
+#pragma once
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <boost/functional/hash.hpp>
+#include <boost/noncopyable.hpp>
+#include <vros/chain/types.hpp>
+
+namespace vros { namespace chain {
+
+/**
+ * Thread-safe LRU cache of public keys recovered from signatures.
+ *
+ * Entries are keyed by signature and remember the digest they were recovered with,
+ * a hit requires both to match. The cache is split into shards by signature hash and
+ * each shard has its own lock, so recovery from multiple threads rarely contends.
+ */
+class signature_cache : boost::noncopyable {
+private:
+    struct entry {
+        signature_type  sig;
+        digest_type     digest;
+        public_key_type key;
+    };
+
+    using lru_list  = std::list<entry>;
+    using index_map = std::unordered_map<signature_type, lru_list::iterator, boost::hash<signature_type>>;
+
+    struct shard {
+        std::mutex mutex;
+        lru_list   lru;
+        index_map  index;
+    };
+
+public:
+    signature_cache(size_t capacity, size_t shards_size = 16);
+
+public:
+    // shared instance used by transactions, suspend approvals and vros links
+    static signature_cache& instance();
+
+public:
+    bool get(const signature_type& sig, const digest_type& digest, public_key_type& key);
+    void put(const signature_type& sig, const digest_type& digest, const public_key_type& key);
+
+    // returns cached key or recovers it and fills the cache
+    public_key_type recover(const signature_type& sig, const digest_type& digest);
+
+    void set_capacity(size_t capacity);
+    void clear();
+
+public:
+    size_t capacity() const { return capacity_; }
+    size_t hits() const { return hits_; }
+    size_t misses() const { return misses_; }
+
+private:
+    shard& get_shard(const signature_type& sig);
+    void   evict(shard& s);
+
+private:
+    std::atomic<size_t>                 capacity_;
+    std::atomic<size_t>                 shard_capacity_;
+    std::atomic<size_t>                 hits_;
+    std::atomic<size_t>                 misses_;
+    std::vector<std::unique_ptr<shard>> shards_;
+};
+
+}}  // namespace vros::chain
@@ -0,0 +1,82 @@
+/**
+ *  @file
+ *  @copyright defined in vros/LICENSE.txt
+ */
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace vros { namespace chain {
+
+// posts `f` to the thread pool and returns a future of its result
+// exceptions thrown by `f` are rethrown by `future::get`
+template<typename F>
+auto
+async_thread_pool(boost::asio::thread_pool& pool, F&& f) {
+    auto task = std::make_shared<std::packaged_task<decltype(f())()>>(std::forward<F>(f));
+    boost::asio::post(pool, [task]() { (*task)(); });
+    return task->get_future();
+}
+
+/**
+ * Queue with limited capacity passing items from producer threads to consumer threads.
+ *
+ * `push` blocks while the queue is full and `pop` blocks while it's empty.
+ * After `close` is called, `push` fails at once and `pop` fails when the remaining items are drained.
+ */
+template<typename T>
+class bounded_queue : boost::noncopyable {
+public:
+    bounded_queue(size_t capacity)
+        : capacity_(capacity), closed_(false) {}
+
+public:
+    bool
+    push(T&& v) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return closed_ || queue_.size() < capacity_; });
+        if(closed_) {
+            return false;
+        }
+        queue_.emplace_back(std::move(v));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    bool
+    pop(T& v) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return closed_ || !queue_.empty(); });
+        if(queue_.empty()) {
+            return false;
+        }
+        v = std::move(queue_.front());
+        queue_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    void
+    close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+private:
+    size_t                  capacity_;
+    bool                    closed_;
+    std::deque<T>           queue_;
+    std::mutex              mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
+
+}}  // namespace vros::chain
@@ -4,14 +4,22 @@
 */
 #pragma once
 #include <deque>
+#include <unordered_set>
 #include <boost/noncopyable.hpp>
 #include <vros/chain/asset.hpp>
 #include <vros/chain/contracts/types.hpp>
+#include <vros/chain/token_database_arena.hpp>
+#include <vros/chain/token_database_cache.hpp>
 #include <functional>
 #include <rocksdb/options.h>
 
 namespace rocksdb {
 class DB;
+class Iterator;
+class Snapshot;
+class Slice;
+class Status;
+class WriteBatchWithIndex;
 }  // namespace rocksdb
 
 // Use only lower 48-bit address for some pointers.
@@ -31,6 +39,19 @@ namespace vros { namespace chain {
 using namespace vros::chain::contracts;
 using read_fungible_func = std::function<bool(const asset&)>;
 using read_prodvote_func = std::function<bool(const public_key_type& pkey, int64_t value)>;
+using asset_keys         = std::vector<std::pair<address, symbol>>;
+
+// objects read from token database, used to tell whether later writes touched any of them
+struct token_read_set {
+    std::vector<domain_name>                     domains;
+    std::vector<symbol_id_type>                  fungibles;
+    std::vector<group_name>                      groups;
+    std::vector<std::pair<domain_name, name128>> tokens;
+    std::vector<proposal_name>                   suspends;
+};
+
+class token_database_snapshot;
+using token_database_snapshot_ptr = std::shared_ptr<const token_database_snapshot>;
 
 class token_database : boost::noncopyable {
 public:
@@ -58,9 +79,17 @@ public:
         };
     };
 
+    // hashes db keys with XXH64
+    struct key_hasher {
+        size_t operator()(const std::string& key) const;
+    };
+
+    using key_unordered_set = std::unordered_set<std::string, key_hasher>;
+
     struct rt_group {
-        const void*            rb_snapshot;
+        key_unordered_set      keys;  // keys already have before-images in this group
         std::vector<rt_action> actions;
+        token_database_arena   arena;  // owns payloads of all the actions
     };
 
     // persistent action
@@ -135,14 +164,18 @@ public:
     };
 
 public:
-    token_database()
+    token_database(size_t cache_size = config::default_tokendb_cache_size)
         : db_(nullptr)
+        , db_opts_()
         , read_opts_()
         , write_opts_()
         , tokens_handle_(nullptr)
         , assets_handle_(nullptr)
-        , savepoints_() {}
-    token_database(const fc::path& dbpath);
+        , savepoints_()
+        , staging_(nullptr)
+        , staging_seq_(-1)
+        , cache_(cache_size) {}
+    token_database(const fc::path& dbpath, size_t cache_size = config::default_tokendb_cache_size);
     ~token_database();
 
 public:
@@ -179,6 +212,9 @@ public:
     // instead of throwing an exception
     int read_asset_no_throw(const address& addr, const symbol, asset&) const;
     int read_all_assets(const address& addr, const read_fungible_func&) const;
+    // batched version of `read_asset` and `read_asset_no_throw`, looks up all the keys in one `MultiGet`
+    // the first `required` keys throw as `read_asset` does when not found, others return asset(0, symbol) instead
+    int read_assets(const asset_keys& keys, std::vector<asset>& assets, size_t required = 0) const;
 
     int read_prodvotes_no_throw(const conf_key& key, const read_prodvote_func&) const;
 
@@ -198,25 +234,53 @@ public:
     session new_savepoint_session(int64_t seq);
     session new_savepoint_session();
 
+    // staging session: mutations since this savepoint are kept in an in-memory batch
+    // and only written to db by `commit_staging`, rollback of it just drops the batch
+    session new_staging_session(int64_t seq);
+    int commit_staging();
+    bool is_staging() const { return staging_ != nullptr; }
+    // true if staged changes touched any of the objects, rolled back changes may still count
+    bool is_staging_written(const token_read_set& reads) const;
+
+    // pins current committed state, the returned view can be read from any thread
+    token_database_snapshot_ptr new_snapshot() const;
+
     size_t get_savepoints_size() const { return savepoints_.size(); }
+    const token_database_cache& get_cache() const { return cache_; }
 
 private:
     int rollback_rt_group(rt_group*);
     int rollback_pd_group(pd_group*);
+    int rollback_staged_rt_group(rt_group*, bool base);
+
+    bool is_staged(const savepoint& sp) const { return staging_ != nullptr && sp.seq >= staging_seq_; }
 
 private:
     int should_record() { return !savepoints_.empty(); }
     int record(int type, void* data);
+    void* new_record(size_t size);
+    int record_image(int type, bool is_new, const rocksdb::Slice& key, rocksdb::ColumnFamilyHandle* cf = nullptr);
     int free_savepoint(savepoint&);
 
 private:
     int persist_savepoints();
     int load_savepoints();
 
+private:
+    // all reads and writes go through these, they see the staging batch first if there is one
+    rocksdb::Status    get(const rocksdb::Slice& key, std::string* value, rocksdb::ColumnFamilyHandle* cf = nullptr) const;
+    bool               key_exists(const rocksdb::Slice& key, rocksdb::ColumnFamilyHandle* cf = nullptr) const;
+    rocksdb::Iterator* new_iterator(rocksdb::ColumnFamilyHandle* cf = nullptr) const;
+    void               put(const rocksdb::Slice& key, const rocksdb::Slice& value, rocksdb::ColumnFamilyHandle* cf = nullptr);
+
+    template<typename T>
+    bool read_object(const rocksdb::Slice& key, T& v, rocksdb::ColumnFamilyHandle* cf = nullptr) const;
+
 private:
     std::string                  db_path_;
 
     rocksdb::DB*                 db_;
+    rocksdb::DBOptions           db_opts_;
     rocksdb::ReadOptions         read_opts_;
     rocksdb::WriteOptions        write_opts_;
 
@@ -224,6 +288,47 @@ private:
     rocksdb::ColumnFamilyHandle* assets_handle_;  
 
     std::deque<savepoint>        savepoints_;
+
+    rocksdb::WriteBatchWithIndex* staging_;
+    int64_t                       staging_seq_;
+    key_unordered_set             staging_written_;  // keys put into staging batch, except assets
+
+    mutable token_database_cache cache_;
+};
+
+/**
+ * Read-only view of token database pinned on a rocksdb snapshot.
+ *
+ * It only reads committed state (staged changes of pending block are invisible) and never touches
+ * the cache of token_database, so its methods are safe to be called concurrently from multiple threads
+ * while the chain thread keeps applying blocks.
+ * The view must not outlive the token_database which creates it.
+ */
+class token_database_snapshot : boost::noncopyable {
+public:
+    token_database_snapshot(rocksdb::DB* db, rocksdb::ColumnFamilyHandle* assets_handle, const rocksdb::ReadOptions& read_opts);
+    ~token_database_snapshot();
+
+public:
+    int exists_domain(const domain_name&) const;
+    int exists_token(const domain_name&, const token_name&) const;
+    int exists_asset(const address& addr, const symbol) const;
+
+    int read_domain(const domain_name&, domain_def&) const;
+    int read_token(const domain_name&, const token_name&, token_def&) const;
+    int read_group(const group_name&, group_def&) const;
+    int read_suspend(const proposal_name&, suspend_def&) const;
+    int read_fungible(const symbol, fungible_def&) const;
+    int read_fungible(const symbol_id_type, fungible_def&) const;
+    int read_asset(const address& addr, const symbol, asset&) const;
+    int read_asset_no_throw(const address& addr, const symbol, asset&) const;
+    int read_all_assets(const address& addr, const read_fungible_func&) const;
+
+private:
+    rocksdb::DB*                 db_;
+    rocksdb::ColumnFamilyHandle* assets_handle_;
+    const rocksdb::Snapshot*     snapshot_;
+    rocksdb::ReadOptions         read_opts_;
 };
 
 }}  // namespace vros::chain
@@ -0,0 +1,88 @@
+/**
+ *  @file
+ *  @copyright defined in vros/LICENSE.txt
+*/
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+namespace vros { namespace chain {
+
+/**
+ * Bump allocator owning all the undo records of one realtime savepoint.
+ *
+ * Records are never freed one by one, the whole arena is released together with its savepoint.
+ * Blocks start small since most savepoints belong to one transaction and only hold a few records,
+ * and then grow geometrically. Squashing savepoints moves the blocks instead of copying records.
+ */
+class token_database_arena : boost::noncopyable {
+public:
+    static const size_t kMinBlockSize = 512;
+    static const size_t kMaxBlockSize = 16 * 1024;
+    static const size_t kAlignment    = alignof(std::max_align_t);
+
+public:
+    token_database_arena()
+        : ptr_(nullptr), remain_(0), next_block_size_(kMinBlockSize) {}
+
+    ~token_database_arena() {
+        for(auto b : blocks_) {
+            free(b);
+        }
+    }
+
+public:
+    void*
+    allocate(size_t size) {
+        size = (size + kAlignment - 1) & ~(kAlignment - 1);
+        if(size > remain_) {
+            if(size > next_block_size_ / 4) {
+                // large record takes its own block and keeps current block for later small ones
+                return new_block(size);
+            }
+            ptr_             = (char*)new_block(next_block_size_);
+            remain_          = next_block_size_;
+            next_block_size_ = std::min(next_block_size_ * 2, kMaxBlockSize);
+        }
+
+        auto p = ptr_;
+        ptr_    += size;
+        remain_ -= size;
+        return p;
+    }
+
+    // takes over all the blocks of `other`, records allocated from it stay valid
+    void
+    splice(token_database_arena& other) {
+        blocks_.insert(blocks_.end(), other.blocks_.cbegin(), other.blocks_.cend());
+        other.blocks_.clear();
+        other.ptr_             = nullptr;
+        other.remain_          = 0;
+        other.next_block_size_ = kMinBlockSize;
+    }
+
+    size_t blocks_size() const { return blocks_.size(); }
+
+private:
+    void*
+    new_block(size_t size) {
+        auto b = malloc(size);
+        if(b == nullptr) {
+            throw std::bad_alloc();
+        }
+        blocks_.emplace_back(b);
+        return b;
+    }
+
+private:
+    char*              ptr_;
+    size_t             remain_;
+    size_t             next_block_size_;
+    std::vector<void*> blocks_;
+};
+
+}}  // namespace vros::chain
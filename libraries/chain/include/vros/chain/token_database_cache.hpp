@@ -0,0 +1,120 @@
+/**
+ *  @file
+ *  @copyright defined in vros/LICENSE.txt
+*/
+#pragma once
+#include <list>
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <type_traits>
+#include <unordered_map>
+#include <boost/noncopyable.hpp>
+#include <fc/exception/exception.hpp>
+
+namespace vros { namespace chain {
+
+/**
+ * Size-bounded LRU cache of decoded token database objects.
+ *
+ * Keys are the raw rocksdb key encodings used by token_database (`db_key` / `db_asset_key`),
+ * the two encodings have different lengths so they never collide in one cache.
+ * Values are kept decoded so hot objects (domains, fungibles, balances) skip both rocksdb and `fc::raw::unpack`.
+ */
+class token_database_cache : boost::noncopyable {
+private:
+    struct entry {
+        std::string           key;
+        const std::type_info* type;
+        std::shared_ptr<void> value;
+    };
+
+    using lru_list  = std::list<entry>;
+    using index_map = std::unordered_map<std::string, lru_list::iterator>;
+
+public:
+    token_database_cache(size_t capacity)
+        : capacity_(capacity), hits_(0), misses_(0) {
+        index_.reserve(capacity);
+    }
+
+public:
+    template<typename T>
+    std::shared_ptr<const T>
+    get(const std::string& key) {
+        auto it = index_.find(key);
+        if(it == index_.end()) {
+            misses_++;
+            return nullptr;
+        }
+        FC_ASSERT(*it->second->type == typeid(T), "Cache entry type is not matched");
+
+        // move to the front: most recently used
+        lru_.splice(lru_.begin(), lru_, it->second);
+        hits_++;
+        return std::static_pointer_cast<const T>(it->second->value);
+    }
+
+    bool
+    exists(const std::string& key) const {
+        return index_.find(key) != index_.end();
+    }
+
+    template<typename T>
+    void
+    put(const std::string& key, T&& v) {
+        using type = std::decay_t<T>;
+        if(capacity_ == 0) {
+            return;
+        }
+
+        auto value = std::static_pointer_cast<void>(std::make_shared<type>(std::forward<T>(v)));
+
+        auto it = index_.find(key);
+        if(it != index_.end()) {
+            it->second->type  = &typeid(type);
+            it->second->value = std::move(value);
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return;
+        }
+
+        if(index_.size() >= capacity_) {
+            auto& last = lru_.back();
+            index_.erase(last.key);
+            lru_.pop_back();
+        }
+        lru_.emplace_front(entry { key, &typeid(type), std::move(value) });
+        index_.emplace(key, lru_.begin());
+    }
+
+    void
+    remove(const std::string& key) {
+        auto it = index_.find(key);
+        if(it == index_.end()) {
+            return;
+        }
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+
+    void
+    clear() {
+        index_.clear();
+        lru_.clear();
+    }
+
+public:
+    size_t size() const { return index_.size(); }
+    size_t capacity() const { return capacity_; }
+    size_t hits() const { return hits_; }
+    size_t misses() const { return misses_; }
+
+private:
+    size_t    capacity_;
+    size_t    hits_;
+    size_t    misses_;
+    lru_list  lru_;
+    index_map index_;
+};
+
+}}  // namespace vros::chain
@@ -31,6 +31,7 @@ private:
     friend struct controller_impl;
     friend class apply_context;
 
+    void dispatch_action(const action& a);
     void dispatch_action(action_trace& trace, const action& a);
     void record_transaction(const transaction_id_type& id, fc::time_point_sec expire);
 
@@ -49,8 +50,9 @@ public:
 
     vector<action_receipt> executed;
 
-    bool     is_input = false;
-    uint32_t charge   = 0;
+    bool     is_input      = false;
+    bool     record_traces = true;  ///< if false, executed actions are not recorded in trace
+    uint32_t charge        = 0;
 
     fc::time_point deadline = fc::time_point::maximum();
 
@@ -17,6 +17,7 @@ class transaction_metadata {
 public:
     transaction_id_type                                      id;
     transaction_id_type                                      signed_id;
+    digest_type                                              packed_digest;  ///< leaf of its receipt in transaction merkle
     signed_transaction                                       trx;
     packed_transaction                                       packed_trx;
     optional<pair<chain_id_type, flat_set<public_key_type>>> signing_keys;
@@ -27,7 +28,8 @@ public:
         , packed_trx(t, c) {
         id = trx.id();
         // raw_packed = fc::raw::pack( static_cast<const transaction&>(trx) );
-        signed_id = digest_type::hash(packed_trx);
+        signed_id     = digest_type::hash(packed_trx);
+        packed_digest = packed_trx.packed_digest();
     }
 
     transaction_metadata(const packed_transaction& ptrx)
@@ -35,7 +37,8 @@ public:
         , packed_trx(ptrx) {
         id = trx.id();
         // raw_packed = fc::raw::pack( static_cast<const transaction&>(trx) );
-        signed_id = digest_type::hash(packed_trx);
+        signed_id     = digest_type::hash(packed_trx);
+        packed_digest = packed_trx.packed_digest();
     }
 
     const flat_set<public_key_type>&
@@ -39,6 +39,16 @@ is_canonical_right(const digest_type& val) {
     return (val._hash[0] & 0x0000000000000080ULL) != 0;
 }
 
+digest_type
+hash_pair(const digest_type& l, const digest_type& r) {
+    auto cl  = make_canonical_left(l);
+    auto cr  = make_canonical_right(r);
+    auto enc = digest_type::encoder();
+    enc.write((const char*)cl._hash, sizeof(cl._hash));
+    enc.write((const char*)cr._hash, sizeof(cr._hash));
+    return enc.result();
+}
+
 digest_type
 merkle(vector<digest_type> ids) {
     if(0 == ids.size()) {
@@ -50,7 +60,7 @@ merkle(vector<digest_type> ids) {
             ids.push_back(ids.back());
 
         for(auto i = 0u; i < ids.size() / 2; i++) {
-            ids[i] = digest_type::hash(make_canonical_pair(ids[2 * i], ids[(2 * i) + 1]));
+            ids[i] = hash_pair(ids[2 * i], ids[(2 * i) + 1]);
         }
 
         ids.resize(ids.size() / 2);
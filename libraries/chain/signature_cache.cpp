@@ -0,0 +1,111 @@
+/**
+ *  @file
+ *  @copyright defined in vros/LICENSE.txt
+ */
+#include <vros/chain/signature_cache.hpp>
+#include <vros/chain/config.hpp>
+
+namespace vros { namespace chain {
+
+signature_cache::signature_cache(size_t capacity, size_t shards_size)
+    : capacity_(capacity)
+    , shard_capacity_((capacity + shards_size - 1) / shards_size)
+    , hits_(0)
+    , misses_(0) {
+    FC_ASSERT(shards_size > 0);
+    shards_.reserve(shards_size);
+    for(auto i = 0u; i < shards_size; i++) {
+        shards_.emplace_back(std::make_unique<shard>());
+    }
+}
+
+signature_cache&
+signature_cache::instance() {
+    static signature_cache cache(config::default_sigs_cache_size);
+    return cache;
+}
+
+signature_cache::shard&
+signature_cache::get_shard(const signature_type& sig) {
+    auto h = boost::hash<signature_type>()(sig);
+    return *shards_[h % shards_.size()];
+}
+
+void
+signature_cache::evict(shard& s) {
+    while(s.index.size() > shard_capacity_) {
+        s.index.erase(s.lru.back().sig);
+        s.lru.pop_back();
+    }
+}
+
+bool
+signature_cache::get(const signature_type& sig, const digest_type& digest, public_key_type& key) {
+    auto& s = get_shard(sig);
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    auto it = s.index.find(sig);
+    if(it == s.index.end() || it->second->digest != digest) {
+        misses_++;
+        return false;
+    }
+    s.lru.splice(s.lru.begin(), s.lru, it->second);
+    key = it->second->key;
+    hits_++;
+    return true;
+}
+
+void
+signature_cache::put(const signature_type& sig, const digest_type& digest, const public_key_type& key) {
+    if(capacity_ == 0) {
+        return;
+    }
+
+    auto& s = get_shard(sig);
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    auto it = s.index.find(sig);
+    if(it != s.index.end()) {
+        it->second->digest = digest;
+        it->second->key    = key;
+        s.lru.splice(s.lru.begin(), s.lru, it->second);
+        return;
+    }
+
+    s.lru.emplace_front(entry { sig, digest, key });
+    s.index.emplace(sig, s.lru.begin());
+    evict(s);
+}
+
+public_key_type
+signature_cache::recover(const signature_type& sig, const digest_type& digest) {
+    auto key = public_key_type();
+    if(get(sig, digest, key)) {
+        return key;
+    }
+    // recover outside of the lock, it's the expensive part
+    key = public_key_type(sig, digest);
+    put(sig, digest, key);
+    return key;
+}
+
+void
+signature_cache::set_capacity(size_t capacity) {
+    capacity_       = capacity;
+    shard_capacity_ = (capacity + shards_.size() - 1) / shards_.size();
+    for(auto& s : shards_) {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        evict(*s);
+    }
+}
+
+void
+signature_cache::clear() {
+    for(auto& s : shards_) {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        s->index.clear();
+        s->lru.clear();
+    }
+}
+
+}}  // namespace vros::chain
@@ -4,6 +4,7 @@
  */
 #include <vros/chain/token_database.hpp>
 
+#include <limits>
 #include <unordered_set>
 #include <fstream>
 
@@ -15,6 +16,7 @@
 #include <rocksdb/slice_transform.h>
 #include <rocksdb/table.h>
 #include <rocksdb/sst_file_manager.h>
+#include <rocksdb/utilities/write_batch_with_index.h>
 
 #include <boost/container/flat_map.hpp>
 
@@ -28,6 +30,11 @@ namespace vros { namespace chain {
 
 using namespace vros::chain;
 
+size_t
+token_database::key_hasher::operator()(const std::string& key) const {
+    return XXH64(key.data(), key.size(), 0);
+}
+
 namespace __internal {
 
 const size_t PKEY_SIZE = sizeof(public_key_type::storage_type::type_at<0>);
@@ -104,14 +111,7 @@ struct db_asset_prefix_key {
     rocksdb::Slice slice;
 };
 
-struct key_hasher {
-    size_t
-    operator()(const std::string& key) const {
-        return XXH64(key.data(), key.size(), 0);
-    }
-};
-
-using key_unordered_set = std::unordered_set<std::string, key_hasher>;
+using key_unordered_set = token_database::key_unordered_set;
 
 inline db_key
 get_domain_key(const domain_name& name) {
@@ -183,6 +183,38 @@ read_value(const V& value) {
     return v;
 }
 
+// checks bloom filters and memtable first, only reads the table files when the key may exist
+// value is pinned instead of copied since it's thrown away
+inline bool
+db_key_exists(rocksdb::DB* db, const rocksdb::ReadOptions& opts, rocksdb::ColumnFamilyHandle* cf, const rocksdb::Slice& key) {
+    auto value = std::string();
+    auto found = false;
+    if(!db->KeyMayExist(opts, cf, key, &value, &found)) {
+        return false;
+    }
+    if(found) {
+        return true;
+    }
+    auto pv = rocksdb::PinnableSlice();
+    return db->Get(opts, cf, key, &pv).ok();
+}
+
+// read object from cache first, otherwise use `load` to read it from db and fill the cache
+template <typename T, typename Func>
+bool
+read_with_cache(token_database_cache& cache, const std::string& key, T& v, Func&& load) {
+    auto ptr = cache.get<T>(key);
+    if(ptr != nullptr) {
+        v = *ptr;
+        return true;
+    }
+    if(!load(v)) {
+        return false;
+    }
+    cache.put(key, v);
+    return true;
+}
+
 enum action_type {
     kRT = 0,
     kPD = 1
@@ -217,29 +249,17 @@ enum pd_action_type {
     kRemoveOrRevert
 };
 
-struct sp_domain {
-    domain_name name;
-};
-
-struct sp_group {
-    group_name name;
-};
-
-struct sp_token {
-    domain_name domain;
-    token_name  name;
-};
-
-struct sp_suspend {
-    proposal_name name;
-};
+// before-image of one key, captured at the first write of the key in one savepoint
+struct sp_image {
+    uint32_t key_size;
+    uint32_t value_size;  // kNoneValue when key didn't exist before
+    char     data[0];     // key followed by old value
 
-struct sp_fungible {
-    symbol_id_type sym_id;
-};
+    rocksdb::Slice key() const { return rocksdb::Slice(data, key_size); }
+    rocksdb::Slice value() const { return rocksdb::Slice(data + key_size, value_size); }
+    bool existed() const { return value_size != kNoneValue; }
 
-struct sp_asset {
-    char key[PKEY_SIZE + sizeof(symbol)];
+    static constexpr uint32_t kNoneValue = std::numeric_limits<uint32_t>::max();
 };
 
 struct sp_issuetoken {
@@ -248,19 +268,19 @@ struct sp_issuetoken {
     token_name  names[0];
 };
 
-struct sp_prodvote {
-    conf_key key;
-};
-
 }  // namespace __internal
 
-token_database::token_database(const fc::path& dbpath)
-    : token_database() {
+token_database::token_database(const fc::path& dbpath, size_t cache_size)
+    : token_database(cache_size) {
     initialize(dbpath);
 }
 
 token_database::~token_database() {
     persist_savepoints();
+    if(staging_ != nullptr) {
+        delete staging_;
+        staging_ = nullptr;
+    }
     if(db_ != nullptr) {
         if(tokens_handle_ != nullptr) {
             delete tokens_handle_;
@@ -291,12 +311,19 @@ token_database::initialize(const fc::path& dbpath) {
     auto assets_plain_table_opts = PlainTableOptions();
     tokens_plain_table_opts.user_key_len = sizeof(name128) + sizeof(name128);
     assets_plain_table_opts.user_key_len = PKEY_SIZE + sizeof(symbol);
+    // bloom filters per prefix let lookups of missing keys skip the table files
+    // store them in the files to avoid rebuilding them when opening tables
+    tokens_plain_table_opts.bloom_bits_per_key  = 10;
+    tokens_plain_table_opts.store_index_in_file = true;
+    assets_plain_table_opts.bloom_bits_per_key  = 10;
+    assets_plain_table_opts.store_index_in_file = true;
 
     options.create_if_missing      = true;
     options.compression            = CompressionType::kLZ4Compression;
     options.bottommost_compression = CompressionType::kZSTD;
     options.table_factory.reset(NewPlainTableFactory(tokens_plain_table_opts));
     options.prefix_extractor.reset(NewFixedPrefixTransform(sizeof(name128)));
+    options.memtable_prefix_bloom_size_ratio = 0.1;
     // options.sst_file_manager.reset(NewSstFileManager(Env::Default()));
 
     auto assets_opts = ColumnFamilyOptions(options);
@@ -304,6 +331,7 @@ token_database::initialize(const fc::path& dbpath) {
     assets_opts.prefix_extractor.reset(NewFixedPrefixTransform(PKEY_SIZE));
 
     read_opts_.prefix_same_as_start = true;
+    db_opts_ = options;
 
     db_path_ = dbpath.to_native_ansi_path();
     if(!fc::exists(db_path_)) {
@@ -343,20 +371,93 @@ token_database::initialize(const fc::path& dbpath) {
     return 0;
 }
 
+rocksdb::Status
+token_database::get(const rocksdb::Slice& key, std::string* value, rocksdb::ColumnFamilyHandle* cf) const {
+    if(cf == nullptr) {
+        cf = db_->DefaultColumnFamily();
+    }
+    if(staging_ != nullptr) {
+        return staging_->GetFromBatchAndDB(db_, read_opts_, cf, key, value);
+    }
+    return db_->Get(read_opts_, cf, key, value);
+}
+
+bool
+token_database::key_exists(const rocksdb::Slice& key, rocksdb::ColumnFamilyHandle* cf) const {
+    using namespace __internal;
+    if(cf == nullptr) {
+        cf = db_->DefaultColumnFamily();
+    }
+    if(staging_ != nullptr) {
+        // keys are never deleted in staging batch, so not found here means not staged
+        auto value  = std::string();
+        auto status = staging_->GetFromBatch(cf, db_opts_, key, &value);
+        if(status.ok()) {
+            return true;
+        }
+        if(status.code() != rocksdb::Status::kNotFound) {
+            FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
+        }
+    }
+    return db_key_exists(db_, read_opts_, cf, key);
+}
+
+rocksdb::Iterator*
+token_database::new_iterator(rocksdb::ColumnFamilyHandle* cf) const {
+    if(cf == nullptr) {
+        cf = db_->DefaultColumnFamily();
+    }
+    auto it = db_->NewIterator(read_opts_, cf);
+    if(staging_ != nullptr) {
+        return staging_->NewIteratorWithBase(cf, it);
+    }
+    return it;
+}
+
+void
+token_database::put(const rocksdb::Slice& key, const rocksdb::Slice& value, rocksdb::ColumnFamilyHandle* cf) {
+    if(cf == nullptr) {
+        cf = db_->DefaultColumnFamily();
+    }
+    if(staging_ != nullptr) {
+        staging_->Put(cf, key, value);
+        if(cf != assets_handle_) {
+            staging_written_.emplace(key.ToString());
+        }
+        return;
+    }
+    auto status = db_->Put(write_opts_, cf, key, value);
+    if(!status.ok()) {
+        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
+    }
+}
+
+template <typename T>
+bool
+token_database::read_object(const rocksdb::Slice& key, T& v, rocksdb::ColumnFamilyHandle* cf) const {
+    using namespace __internal;
+    auto value  = std::string();
+    auto status = get(key, &value, cf);
+    if(!status.ok()) {
+        if(status.code() != rocksdb::Status::kNotFound) {
+            FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
+        }
+        return false;
+    }
+    v = read_value<T>(value);
+    return true;
+}
+
 int
 token_database::add_domain(const domain_def& domain) {
     using namespace __internal;
     auto key    = get_domain_key(domain.name);
     auto value  = get_value(domain);
-    auto status = db_->Put(write_opts_, key.as_slice(), value);
-    if(!status.ok()) {
-        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
-    }
     if(should_record()) {
-        auto act  = (sp_domain*)malloc(sizeof(sp_domain));
-        act->name = domain.name;
-        record(kNewDomain, act);
+        record_image(kNewDomain, true, key.as_slice());
     }
+    put(key.as_slice(), value);
+    cache_.put(key.as_string(), domain);
     return 0;
 }
 
@@ -364,9 +465,10 @@ int
 token_database::exists_domain(const domain_name& name) const {
     using namespace __internal;
     auto key    = get_domain_key(name);
-    auto value  = std::string();
-    auto status = db_->Get(read_opts_, key.as_slice(), &value);
-    return status.ok();
+    if(cache_.exists(key.as_string())) {
+        return true;
+    }
+    return key_exists(key.as_slice());
 }
 
 int
@@ -375,18 +477,25 @@ token_database::issue_tokens(const issuetoken& issue) {
     if(!exists_domain(issue.domain)) {
         vros_THROW(tokendb_domain_not_found, "Cannot find domain: ${name}", ("name", (std::string)issue.domain));
     }
-    rocksdb::WriteBatch batch;
+    // put all the tokens into staging batch directly if there is one
+    auto batch = rocksdb::WriteBatch();
+    auto wb    = (staging_ != nullptr) ? static_cast<rocksdb::WriteBatchBase*>(staging_) : &batch;
     for(auto name : issue.names) {
         auto key   = get_token_key(issue.domain, name);
         auto value = get_value(token_def(issue.domain, name, issue.owner));
-        batch.Put(key.as_slice(), value);
+        wb->Put(key.as_slice(), value);
+        if(staging_ != nullptr) {
+            staging_written_.emplace(key.as_string());
+        }
     }
-    auto status = db_->Write(write_opts_, &batch);
-    if(!status.ok()) {
-        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
+    if(staging_ == nullptr) {
+        auto status = db_->Write(write_opts_, &batch);
+        if(!status.ok()) {
+            FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
+        }
     }
     if(should_record()) {
-        auto act    = (sp_issuetoken*)malloc(sizeof(sp_issuetoken) + sizeof(token_name) * issue.names.size());
+        auto act    = (sp_issuetoken*)new_record(sizeof(sp_issuetoken) + sizeof(token_name) * issue.names.size());
         act->domain = issue.domain;
         act->size   = issue.names.size();
         memcpy(act->names, &issue.names[0], sizeof(token_name) * act->size);
@@ -399,9 +508,10 @@ int
 token_database::exists_token(const domain_name& domain, const token_name& name) const {
     using namespace __internal;
     auto key    = get_token_key(domain, name);
-    auto value  = std::string();
-    auto status = db_->Get(read_opts_, key.as_slice(), &value);
-    return status.ok();
+    if(cache_.exists(key.as_string())) {
+        return true;
+    }
+    return key_exists(key.as_slice());
 }
 
 int
@@ -409,15 +519,13 @@ token_database::add_group(const group_def& group) {
     using namespace __internal;
     auto key    = get_group_key(group.name());
     auto value  = get_value(group);
-    auto status = db_->Put(write_opts_, key.as_slice(), value);
-    if(!status.ok()) {
-        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
-    }
     if(should_record()) {
-        auto act  = (sp_group*)malloc(sizeof(sp_group));
-        act->name = group.name();
-        record(kNewGroup, act);
+        record_image(kNewGroup, true, key.as_slice());
     }
+    put(key.as_slice(), value);
+    // cached group keeps its compiled program
+    group.compile();
+    cache_.put(key.as_string(), group);
     return 0;
 }
 
@@ -425,9 +533,10 @@ int
 token_database::exists_group(const group_name& name) const {
     using namespace __internal;
     auto key    = get_group_key(name);
-    auto value  = std::string();
-    auto status = db_->Get(read_opts_, key.as_slice(), &value);
-    return status.ok();
+    if(cache_.exists(key.as_string())) {
+        return true;
+    }
+    return key_exists(key.as_slice());
 }
 
 int
@@ -435,15 +544,11 @@ token_database::add_suspend(const suspend_def& suspend) {
     using namespace __internal;
     auto key    = get_suspend_key(suspend.name);
     auto value  = get_value(suspend);
-    auto status = db_->Put(write_opts_, key.as_slice(), value);
-    if(!status.ok()) {
-        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
-    }
     if(should_record()) {
-        auto act  = (sp_suspend*)malloc(sizeof(sp_suspend));
-        act->name = suspend.name;
-        record(kNewSuspend, act);
+        record_image(kNewSuspend, true, key.as_slice());
     }
+    put(key.as_slice(), value);
+    cache_.put(key.as_string(), suspend);
     return 0;
 }
 
@@ -451,9 +556,10 @@ int
 token_database::exists_suspend(const proposal_name& name) const {
     using namespace __internal;
     auto key    = get_suspend_key(name);
-    auto value  = std::string();
-    auto status = db_->Get(read_opts_, key.as_slice(), &value);
-    return status.ok();
+    if(cache_.exists(key.as_string())) {
+        return true;
+    }
+    return key_exists(key.as_slice());
 }
 
 int
@@ -461,15 +567,11 @@ token_database::add_fungible(const fungible_def& fungible) {
     using namespace __internal;
     auto key    = get_fungible_key(fungible.sym);
     auto value  = get_value(fungible);
-    auto status = db_->Put(write_opts_, key.as_slice(), value);
-    if(!status.ok()) {
-        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
-    }
     if(should_record()) {
-        auto act  = (sp_fungible*)malloc(sizeof(sp_fungible));
-        act->sym_id = fungible.sym.id();
-        record(kNewFungible, act);
+        record_image(kNewFungible, true, key.as_slice());
     }
+    put(key.as_slice(), value);
+    cache_.put(key.as_string(), fungible);
     return 0;
 }
 
@@ -477,18 +579,20 @@ int
 token_database::exists_fungible(const symbol sym) const {
     using namespace __internal;
     auto key    = get_fungible_key(sym);
-    auto value  = std::string();
-    auto status = db_->Get(read_opts_, key.as_slice(), &value);
-    return status.ok();
+    if(cache_.exists(key.as_string())) {
+        return true;
+    }
+    return key_exists(key.as_slice());
 }
 
 int
 token_database::exists_fungible(const symbol_id_type sym_id) const {
     using namespace __internal;
     auto key    = get_fungible_key(sym_id);
-    auto value  = std::string();
-    auto status = db_->Get(read_opts_, key.as_slice(), &value);
-    return status.ok();
+    if(cache_.exists(key.as_string())) {
+        return true;
+    }
+    return key_exists(key.as_slice());
 }
 
 int
@@ -496,26 +600,22 @@ token_database::update_asset(const address& addr, const asset& asset) {
     using namespace __internal;
     auto key    = get_asset_key(addr, asset);
     auto value  = get_value(asset);
-    auto status = db_->Put(write_opts_, assets_handle_, key.as_slice(), value);
-    if(!status.ok()) {
-        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
-    }
     if(should_record()) {
-        auto act  = (sp_asset*)malloc(sizeof(sp_asset));
-        memcpy(act->key, key.buf, sizeof(key.buf));
-        record(kUpdateAsset, act);
+        record_image(kUpdateAsset, false, key.as_slice(), assets_handle_);
     }
+    put(key.as_slice(), value, assets_handle_);
+    cache_.put(key.as_string(), asset);
     return 0;
 }
 
 int
 token_database::exists_any_asset(const address& addr) const {
     using namespace __internal;
-    auto it  = db_->NewIterator(read_opts_, assets_handle_);
+    auto it  = new_iterator(assets_handle_);
     auto key = get_asset_prefix_key(addr);
     it->Seek(key.as_slice());
 
-    auto existed = it->Valid();
+    auto existed = it->Valid() && it->key().starts_with(key.as_slice());
     delete it;
 
     return existed;
@@ -524,14 +624,11 @@ token_database::exists_any_asset(const address& addr) const {
 int
 token_database::exists_asset(const address& addr, const symbol symbol) const {
     using namespace __internal;
-    auto it  = db_->NewIterator(read_opts_, assets_handle_);
     auto key = get_asset_key(addr, symbol);
-    it->Seek(key.as_slice());
-
-    auto existed = it->Valid() && it->key().compare(key.as_slice()) == 0;
-    delete it;
-
-    return existed;
+    if(cache_.exists(key.as_string())) {
+        return true;
+    }
+    return key_exists(key.as_slice(), assets_handle_);
 }
 
 int
@@ -542,7 +639,7 @@ token_database::update_prodvote(const conf_key& key, const public_key_type& pkey
     auto dbkey  = get_prodvote_key(key);
     auto v      = std::string();
     auto map    = flat_map<public_key_type, int64_t>();
-    auto status = db_->Get(read_opts_, dbkey.as_slice(), &v);
+    auto status = get(dbkey.as_slice(), &v);
     if(!status.ok()) {
         if(status.code() != rocksdb::Status::kNotFound) {
             FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
@@ -554,138 +651,197 @@ token_database::update_prodvote(const conf_key& key, const public_key_type& pkey
         map.emplace(pkey, value);
     }
     v = get_value(map);
-    
-    status = db_->Put(write_opts_, dbkey.as_slice(), v);
-    if(!status.ok()) {
-        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
-    }
     if(should_record()) {
-        auto act  = (sp_prodvote*)malloc(sizeof(sp_prodvote));
-        act->key = key;
-        record(kUpdateProdVote, act);
+        record_image(kUpdateProdVote, false, dbkey.as_slice());
     }
+    put(dbkey.as_slice(), v);
     return 0;
 }
 
 int
 token_database::read_domain(const domain_name& name, domain_def& domain) const {
     using namespace __internal;
-    auto value  = std::string();
-    auto key    = get_domain_key(name);
-    auto status = db_->Get(read_opts_, key.as_slice(), &value);
-    if(!status.ok()) {
+    auto key = get_domain_key(name);
+    auto ok  = read_with_cache(cache_, key.as_string(), domain, [&](auto& v) {
+        return read_object(key.as_slice(), v);
+    });
+    if(!ok) {
         vros_THROW(tokendb_domain_not_found, "Cannot find domain: ${name}", ("name",name));
     }
-    domain = read_value<domain_def>(value);
     return 0;
 }
 
 int
 token_database::read_token(const domain_name& domain, const token_name& name, token_def& token) const {
     using namespace __internal;
-    auto value  = std::string();
-    auto key    = get_token_key(domain, name);
-    auto status = db_->Get(read_opts_, key.as_slice(), &value);
-    if(!status.ok()) {
+    auto key = get_token_key(domain, name);
+    auto ok  = read_with_cache(cache_, key.as_string(), token, [&](auto& v) {
+        return read_object(key.as_slice(), v);
+    });
+    if(!ok) {
         vros_THROW(tokendb_token_not_found, "Cannot find token: ${domain}-${name}", ("domain",domain)("name",name));
     }
-    token = read_value<token_def>(value);
     return 0;
 }
 
 int
 token_database::read_group(const group_name& id, group_def& group) const {
     using namespace __internal;
-    auto value  = std::string();
-    auto key    = get_group_key(id);
-    auto status = db_->Get(read_opts_, key.as_slice(), &value);
-    if(!status.ok()) {
+    auto key = get_group_key(id);
+    auto ok  = read_with_cache(cache_, key.as_string(), group, [&](auto& v) {
+        if(!read_object(key.as_slice(), v)) {
+            return false;
+        }
+        // compile once when loaded, copies from cache share the program
+        v.compile();
+        return true;
+    });
+    if(!ok) {
         vros_THROW(tokendb_group_not_found, "Cannot find group: ${id}", ("id",id));
     }
-    group = read_value<group_def>(value);
     return 0;
 }
 
 int
 token_database::read_suspend(const proposal_name& name, suspend_def& suspend) const {
     using namespace __internal;
-    auto value  = std::string();
-    auto key    = get_suspend_key(name);
-    auto status = db_->Get(read_opts_, key.as_slice(), &value);
-    if(!status.ok()) {
+    auto key = get_suspend_key(name);
+    auto ok  = read_with_cache(cache_, key.as_string(), suspend, [&](auto& v) {
+        return read_object(key.as_slice(), v);
+    });
+    if(!ok) {
         vros_THROW(tokendb_suspend_not_found, "Cannot find suspend: ${name}", ("name",name));
     }
-    suspend = read_value<suspend_def>(value);
     return 0;
 }
 
 int
 token_database::read_fungible(const symbol sym, fungible_def& fungible) const {
     using namespace __internal;
-    auto value  = std::string();
-    auto key    = get_fungible_key(sym);
-    auto status = db_->Get(read_opts_, key.as_slice(), &value);
-    if(!status.ok()) {
+    auto key = get_fungible_key(sym);
+    auto ok  = read_with_cache(cache_, key.as_string(), fungible, [&](auto& v) {
+        return read_object(key.as_slice(), v);
+    });
+    if(!ok) {
         vros_THROW(tokendb_fungible_not_found, "Cannot find fungible def: ${sym}", ("sym",sym));
     }
-    fungible = read_value<fungible_def>(value);
     return 0;
 }
 
 int
 token_database::read_fungible(const symbol_id_type sym_id, fungible_def& fungible) const {
     using namespace __internal;
-    auto value  = std::string();
-    auto key    = get_fungible_key(sym_id);
-    auto status = db_->Get(read_opts_, key.as_slice(), &value);
-    if(!status.ok()) {
+    auto key = get_fungible_key(sym_id);
+    auto ok  = read_with_cache(cache_, key.as_string(), fungible, [&](auto& v) {
+        return read_object(key.as_slice(), v);
+    });
+    if(!ok) {
         vros_THROW(tokendb_fungible_not_found, "Cannot find fungible def: ${id}", ("id",sym_id));
     }
-    fungible = read_value<fungible_def>(value);
     return 0;
 }
 
 int
 token_database::read_asset(const address& addr, const symbol symbol, asset& v) const {
     using namespace __internal;
-    auto it  = db_->NewIterator(read_opts_, assets_handle_);
     auto key = get_asset_key(addr, symbol);
-    it->Seek(key.as_slice());
-
-    if(!it->Valid() || it->key().compare(key.as_slice()) != 0) {
-        delete it;
+    auto ok  = read_with_cache(cache_, key.as_string(), v, [&](auto& v) {
+        return read_object(key.as_slice(), v, assets_handle_);
+    });
+    if(!ok) {
         vros_THROW(tokendb_asset_not_found, "Cannot find fungible: ${sym} in address: {addr}", ("sym",symbol)("addr",addr));
     }
-    v = read_value<asset>(it->value());
-    delete it;
     return 0;
 }
 
 int
 token_database::read_asset_no_throw(const address& addr, const symbol symbol, asset& v) const {
     using namespace __internal;
-    auto it  = db_->NewIterator(read_opts_, assets_handle_);
     auto key = get_asset_key(addr, symbol);
-    it->Seek(key.as_slice());
-
-    if(!it->Valid() || it->key().compare(key.as_slice()) != 0) {
-        delete it;
+    auto ok  = read_with_cache(cache_, key.as_string(), v, [&](auto& v) {
+        return read_object(key.as_slice(), v, assets_handle_);
+    });
+    if(!ok) {
         v = asset(0, symbol);
-        return 0;
     }
-    v = read_value<asset>(it->value());
-    delete it;
+    return 0;
+}
+
+int
+token_database::read_assets(const asset_keys& keys, std::vector<asset>& assets, size_t required) const {
+    using namespace __internal;
+
+    assets.clear();
+    assets.reserve(keys.size());
+
+    auto found   = std::vector<char>(keys.size(), true);
+    auto dbkeys  = std::vector<std::string>();
+    auto misses  = std::vector<size_t>();
+    for(auto i = 0u; i < keys.size(); i++) {
+        auto& k   = keys[i];
+        auto  key = get_asset_key(k.first, k.second).as_string();
+        assets.emplace_back(asset(0, k.second));
+
+        auto ptr = cache_.get<asset>(key);
+        if(ptr != nullptr) {
+            assets[i] = *ptr;
+            continue;
+        }
+        if(staging_ != nullptr) {
+            // assets are never deleted in staging batch, so not found here means not staged
+            auto value  = std::string();
+            auto status = staging_->GetFromBatch(assets_handle_, db_opts_, key, &value);
+            if(status.ok()) {
+                assets[i] = read_value<asset>(value);
+                cache_.put(key, assets[i]);
+                continue;
+            }
+            if(status.code() != rocksdb::Status::kNotFound) {
+                FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
+            }
+        }
+        dbkeys.emplace_back(std::move(key));
+        misses.emplace_back(i);
+    }
+
+    if(!dbkeys.empty()) {
+        auto slices   = std::vector<rocksdb::Slice>(dbkeys.cbegin(), dbkeys.cend());
+        auto handles  = std::vector<rocksdb::ColumnFamilyHandle*>(dbkeys.size(), assets_handle_);
+        auto values   = std::vector<std::string>();
+        auto statuses = db_->MultiGet(read_opts_, handles, slices, &values);
+
+        for(auto i = 0u; i < statuses.size(); i++) {
+            auto& status = statuses[i];
+            if(!status.ok()) {
+                if(status.code() != rocksdb::Status::kNotFound) {
+                    FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
+                }
+                found[misses[i]] = false;
+                continue;
+            }
+            auto& v = assets[misses[i]];
+            v = read_value<asset>(values[i]);
+            cache_.put(dbkeys[i], v);
+        }
+    }
+
+    for(auto i = 0u; i < required && i < keys.size(); i++) {
+        if(!found[i]) {
+            vros_THROW(tokendb_asset_not_found, "Cannot find fungible: ${sym} in address: {addr}", ("sym",keys[i].second)("addr",keys[i].first));
+        }
+    }
     return 0;
 }
 
 int
 token_database::read_all_assets(const address& addr, const read_fungible_func& func) const {
     using namespace __internal;
-    auto it  = db_->NewIterator(read_opts_, assets_handle_);
+    auto it  = new_iterator(assets_handle_);
     auto key = get_asset_prefix_key(addr);
     it->Seek(key.as_slice());
 
-    while(it->Valid()) {
+    // staging iterator doesn't respect `prefix_same_as_start`, check prefix here
+    while(it->Valid() && it->key().starts_with(key.as_slice())) {
         auto v = read_value<asset>(it->value());
         if(!func(v)) {
             break;
@@ -703,7 +859,7 @@ token_database::read_prodvotes_no_throw(const conf_key& key, const read_prodvote
 
     auto value  = std::string();
     auto dbkey  = get_prodvote_key(key);
-    auto status = db_->Get(read_opts_, dbkey.as_slice(), &value);
+    auto status = get(dbkey.as_slice(), &value);
     if(!status.ok() && status.code() != rocksdb::Status::kNotFound) {
         FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
     }
@@ -725,15 +881,11 @@ token_database::update_domain(const domain_def& domain) {
     using namespace __internal;
     auto key    = get_domain_key(domain.name);
     auto value  = get_value(domain);
-    auto status = db_->Put(write_opts_, key.as_slice(), value);
-    if(!status.ok()) {
-        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
-    }
     if(should_record()) {
-        auto act  = (sp_domain*)malloc(sizeof(sp_domain));
-        act->name = domain.name;
-        record(kUpdateDomain, act);
+        record_image(kUpdateDomain, false, key.as_slice());
     }
+    put(key.as_slice(), value);
+    cache_.put(key.as_string(), domain);
     return 0;
 }
 
@@ -742,15 +894,13 @@ token_database::update_group(const group& group) {
     using namespace __internal;
     auto key    = get_group_key(group.name());
     auto value  = get_value(group);
-    auto status = db_->Put(write_opts_, key.as_slice(), value);
-    if(!status.ok()) {
-        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
-    }
     if(should_record()) {
-        auto act  = (sp_group*)malloc(sizeof(sp_group));
-        act->name = group.name();
-        record(kUpdateGroup, act);
+        record_image(kUpdateGroup, false, key.as_slice());
     }
+    put(key.as_slice(), value);
+    // cached group keeps its compiled program
+    group.compile();
+    cache_.put(key.as_string(), group);
     return 0;
 }
 
@@ -759,16 +909,11 @@ token_database::update_token(const token_def& token) {
     using namespace __internal;
     auto key    = get_token_key(token.domain, token.name);
     auto value  = get_value(token);
-    auto status = db_->Put(write_opts_, key.as_slice(), value);
-    if(!status.ok()) {
-        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
-    }
     if(should_record()) {
-        auto act    = (sp_token*)malloc(sizeof(sp_token));
-        act->domain = token.domain;
-        act->name   = token.name;
-        record(kUpdateToken, act);
+        record_image(kUpdateToken, false, key.as_slice());
     }
+    put(key.as_slice(), value);
+    cache_.put(key.as_string(), token);
     return 0;
 }
 
@@ -777,15 +922,11 @@ token_database::update_suspend(const suspend_def& suspend) {
     using namespace __internal;
     auto key    = get_suspend_key(suspend.name);
     auto value  = get_value(suspend);
-    auto status = db_->Put(write_opts_, key.as_slice(), value);
-    if(!status.ok()) {
-        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
-    }
     if(should_record()) {
-        auto act  = (sp_suspend*)malloc(sizeof(sp_suspend));
-        act->name = suspend.name;
-        record(kUpdateSuspend, act);
+        record_image(kUpdateSuspend, false, key.as_slice());
     }
+    put(key.as_slice(), value);
+    cache_.put(key.as_string(), suspend);
     return 0;
 }
 
@@ -794,15 +935,11 @@ token_database::update_fungible(const fungible_def& fungible) {
     using namespace __internal;
     auto key    = get_fungible_key(fungible.sym);
     auto value  = get_value(fungible);
-    auto status = db_->Put(write_opts_, key.as_slice(), value);
-    if(!status.ok()) {
-        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
-    }
     if(should_record()) {
-        auto act  = (sp_fungible*)malloc(sizeof(sp_fungible));
-        act->sym_id = fungible.sym.id();
-        record(kUpdateFungible, act);
+        record_image(kUpdateFungible, false, key.as_slice());
     }
+    put(key.as_slice(), value);
+    cache_.put(key.as_string(), fungible);
     return 0;
 }
 
@@ -816,7 +953,61 @@ token_database::record(int type, void* data) {
     auto n = savepoints_.back().node;
     FC_ASSERT(n.f.type == kRT);
 
-    GETPOINTER(rt_group, n.group)->actions.emplace_back(rt_action(type, data));
+    auto rt = GETPOINTER(rt_group, n.group);
+    if(type == kIssueToken) {
+        // tokens are new ones, later updates of them in this savepoint need no before-images
+        auto act = (sp_issuetoken*)data;
+        for(size_t i = 0; i < act->size; i++) {
+            rt->keys.emplace(get_token_key(act->domain, act->names[i]).as_string());
+        }
+    }
+    rt->actions.emplace_back(rt_action(type, data));
+    return 0;
+}
+
+void*
+token_database::new_record(size_t size) {
+    using namespace __internal;
+
+    auto n = savepoints_.back().node;
+    FC_ASSERT(n.f.type == kRT);
+
+    auto rt = GETPOINTER(rt_group, n.group);
+    return rt->arena.allocate(size);
+}
+
+int
+token_database::record_image(int type, bool is_new, const rocksdb::Slice& key, rocksdb::ColumnFamilyHandle* cf) {
+    using namespace __internal;
+
+    auto n = savepoints_.back().node;
+    FC_ASSERT(n.f.type == kRT);
+
+    // only the first write of one key in this savepoint needs its before-image
+    auto rt = GETPOINTER(rt_group, n.group);
+    auto k  = key.ToString();
+    if(rt->keys.find(k) != rt->keys.cend()) {
+        return 0;
+    }
+
+    auto old_value = std::string();
+    auto existed   = false;
+    if(!is_new) {
+        auto status = get(key, &old_value, cf);
+        if(!status.ok() && status.code() != rocksdb::Status::kNotFound) {
+            FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
+        }
+        existed = status.ok();
+    }
+
+    auto img        = (sp_image*)rt->arena.allocate(sizeof(sp_image) + key.size() + old_value.size());
+    img->key_size   = key.size();
+    img->value_size = existed ? old_value.size() : sp_image::kNoneValue;
+    memcpy(img->data, key.data(), key.size());
+    memcpy(img->data + key.size(), old_value.data(), old_value.size());
+
+    rt->keys.emplace(std::move(k));
+    rt->actions.emplace_back(rt_action(type, img));
     return 0;
 }
 
@@ -837,6 +1028,81 @@ token_database::new_savepoint_session() {
     return session(*this, seq);
 }
 
+token_database::session
+token_database::new_staging_session(int64_t seq) {
+    vros_ASSERT(staging_ == nullptr, tokendb_staging_exception, "There's already one staging session");
+
+    // base savepoint of staging doesn't need a savepoint in the batch:
+    // rolling back to it means dropping the whole batch
+    add_savepoint(seq);
+    staging_     = new rocksdb::WriteBatchWithIndex(rocksdb::BytewiseComparator(), 0, true /* overwrite_key */);
+    staging_seq_ = seq;
+
+    staging_written_.clear();
+
+    return session(*this, seq);
+}
+
+int
+token_database::commit_staging() {
+    vros_ASSERT(staging_ != nullptr, tokendb_staging_exception, "There's no staging session");
+    vros_ASSERT(!savepoints_.empty() && savepoints_.back().seq == staging_seq_, tokendb_staging_exception,
+        "Cannot commit staging when there're pending savepoints inside");
+
+    auto status = db_->Write(write_opts_, staging_->GetWriteBatch());
+    if(!status.ok()) {
+        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
+    }
+
+    // savepoint of staging is a normal one from now on,
+    // its before-images were captured before any staged writes so it can still be rolled back
+    delete staging_;
+    staging_     = nullptr;
+    staging_seq_ = -1;
+
+    staging_written_.clear();
+
+    return 0;
+}
+
+bool
+token_database::is_staging_written(const token_read_set& reads) const {
+    using namespace __internal;
+
+    if(staging_written_.empty()) {
+        return false;
+    }
+    auto written = [this](const db_key& key) {
+        return staging_written_.find(key.as_string()) != staging_written_.cend();
+    };
+    for(auto& d : reads.domains) {
+        if(written(get_domain_key(d))) {
+            return true;
+        }
+    }
+    for(auto& f : reads.fungibles) {
+        if(written(get_fungible_key(f))) {
+            return true;
+        }
+    }
+    for(auto& g : reads.groups) {
+        if(written(get_group_key(g))) {
+            return true;
+        }
+    }
+    for(auto& t : reads.tokens) {
+        if(written(get_token_key(t.first, t.second))) {
+            return true;
+        }
+    }
+    for(auto& s : reads.suspends) {
+        if(written(get_suspend_key(s))) {
+            return true;
+        }
+    }
+    return false;
+}
+
 int
 token_database::add_savepoint(int64_t seq) {
     using namespace __internal;
@@ -849,8 +1115,12 @@ token_database::add_savepoint(int64_t seq) {
         }
     }
 
+    if(staging_ != nullptr) {
+        staging_->SetSavePoint();
+    }
+
     savepoints_.emplace_back(savepoint(seq, kRT));
-    auto rt = new rt_group { .rb_snapshot = (const void*)db_->GetSnapshot(), .actions = {} }; 
+    auto rt = new rt_group();
     SETPOINTER(void, savepoints_.back().node.group, rt);
 
     return 0;
@@ -864,11 +1134,8 @@ token_database::free_savepoint(savepoint& sp) {
 
     switch(n.f.type) {
     case kRT: {
+        // all the payloads are released together with the arena
         auto rt = GETPOINTER(rt_group, n.group);
-        for(auto& act : rt->actions) {
-            free(GETPOINTER(void, act.data));
-        }
-        db_->ReleaseSnapshot((const rocksdb::Snapshot*)rt->rb_snapshot);
         delete rt;
         break;
     }
@@ -887,7 +1154,8 @@ token_database::free_savepoint(savepoint& sp) {
 
 int
 token_database::pop_savepoints(int64_t until) {
-    while(!savepoints_.empty() && savepoints_.front().seq < until) {
+    // staged savepoints are kept until staging is committed
+    while(!savepoints_.empty() && savepoints_.front().seq < until && !is_staged(savepoints_.front())) {
         auto it = std::move(savepoints_.front());
         savepoints_.pop_front();
         free_savepoint(it);
@@ -899,6 +1167,11 @@ int
 token_database::pop_back_savepoint() {
     vros_ASSERT(!savepoints_.empty(), tokendb_no_savepoint, "There's no savepoints anymore");
 
+    if(is_staged(savepoints_.back())) {
+        vros_ASSERT(savepoints_.back().seq != staging_seq_, tokendb_staging_exception, "Cannot pop base savepoint of staging");
+        staging_->PopSavePoint();
+    }
+
     auto it = std::move(savepoints_.back());
     savepoints_.pop_back();
     free_savepoint(it);
@@ -913,196 +1186,136 @@ token_database::squash() {
     auto n = savepoints_.back().node;
     vros_ASSERT(n.f.type == kRT, tokendb_squash_exception, "Squash needs two realtime savepoints.");
 
+    auto staged = is_staged(savepoints_.back());
+    vros_ASSERT(!staged || savepoints_.back().seq != staging_seq_, tokendb_squash_exception, "Cannot squash base savepoint of staging.");
+
     savepoints_.pop_back();
     auto n2 = savepoints_.back().node;
     vros_ASSERT(n2.f.type == kRT, tokendb_squash_exception, "Squash needs two realtime savepoints.");
 
+    if(staged) {
+        // keep the staged changes, only forget the savepoint in batch
+        staging_->PopSavePoint();
+    }
+
     auto rt1 = GETPOINTER(rt_group, n.group);
     auto rt2 = GETPOINTER(rt_group, n2.group);
 
-    // add all actions from rt1 into end of rt2
-    rt2->actions.insert(rt2->actions.cend(), rt1->actions.cbegin(), rt1->actions.cend());
+    // add actions from rt1 into end of rt2
+    // before-images already in rt2 are older, drop the ones from rt1 for the same keys
+    for(auto& act : rt1->actions) {
+        if(act.f.type == kIssueToken) {
+            auto itact = GETPOINTER(sp_issuetoken, act.data);
+            for(size_t i = 0; i < itact->size; i++) {
+                rt2->keys.emplace(get_token_key(itact->domain, itact->names[i]).as_string());
+            }
+            rt2->actions.emplace_back(act);
+            continue;
+        }
 
-    // just release rt1's snapshot
-    db_->ReleaseSnapshot((const rocksdb::Snapshot*)rt1->rb_snapshot);
-    delete rt1;
+        auto img = GETPOINTER(sp_image, act.data);
+        if(!rt2->keys.emplace(img->key().ToString()).second) {
+            continue;
+        }
+        rt2->actions.emplace_back(act);
+    }
+    // payloads of rt1 are referenced by rt2 now
+    rt2->arena.splice(rt1->arena);
 
+    delete rt1;
     return 0;
 }
 
 namespace __internal {
 
-std::string
-get_sp_keyop(const token_database::rt_action& it, int& op) {
-    // for the db action type, New-Ops are odd and Update-Ops are even
-    // for Update-Ops return kRevert(0) and returns kRemove(1) for New-Ops
-    op = it.f.type % 2;
-
-    switch(it.f.type) {
-    case kNewDomain:
-    case kUpdateDomain: {
-        auto act = GETPOINTER(sp_domain, it.data);
-        return get_domain_key(act->name).as_string();
-    }
-    case kUpdateToken: {
-        auto act = GETPOINTER(sp_token, it.data);
-        return get_token_key(act->domain, act->name).as_string();
-    }
-    case kNewGroup:
-    case kUpdateGroup: {
-        auto act = GETPOINTER(sp_group, it.data);
-        return get_group_key(act->name).as_string();
-    }
-    case kNewSuspend:
-    case kUpdateSuspend: {
-        auto act = GETPOINTER(sp_suspend, it.data);
-        return get_suspend_key(act->name).as_string();
-    }
-    case kNewFungible:
-    case kUpdateFungible: {
-        auto act = GETPOINTER(sp_fungible, it.data);
-        return get_fungible_key(act->sym_id).as_string();
-    }
-    case kUpdateAsset: {
-        op = kRemoveOrRevert;
-        auto act = GETPOINTER(sp_asset, it.data);
-        return std::string(act->key, sizeof(act->key));
-    }
-    case kUpdateProdVote: {
-        op = kRemoveOrRevert;
-        auto act = GETPOINTER(sp_prodvote, it.data);
-        return get_prodvote_key(act->key).as_string();
-    }
-    default: {
-        FC_ASSERT(false);
+// invokes `cb` with every key touched by this action
+template <typename Func>
+void
+visit_sp_keys(const token_database::rt_action& act, Func&& cb) {
+    if(act.f.type == kIssueToken) {
+        auto itact = GETPOINTER(sp_issuetoken, act.data);
+        for(size_t i = 0; i < itact->size; i++) {
+            cb(get_token_key(itact->domain, itact->names[i]).as_string());
+        }
+        return;
     }
-    }  // switch
+    auto img = GETPOINTER(sp_image, act.data);
+    cb(img->key().ToString());
 }
 
 }  // namespace __internal
 
+int
+token_database::rollback_staged_rt_group(rt_group* rt, bool base) {
+    using namespace __internal;
+
+    // staged changes never reach db, only need to drop them from cache
+    for(auto& act : rt->actions) {
+        visit_sp_keys(act, [this](const auto& key) {
+            cache_.remove(key);
+        });
+    }
+
+    if(base) {
+        delete staging_;
+        staging_     = nullptr;
+        staging_seq_ = -1;
+
+        staging_written_.clear();
+    }
+    else {
+        staging_->RollbackToSavePoint();
+    }
+    return 0;
+}
+
 int
 token_database::rollback_rt_group(rt_group* rt) {
     using namespace __internal;
+    FC_ASSERT(staging_ == nullptr, "Cannot rollback normal savepoint when staging");
 
     if(rt->actions.empty()) {
-        db_->ReleaseSnapshot((const rocksdb::Snapshot*)rt->rb_snapshot);
         return 0;
     }
 
-    auto snapshot_read_opts_     = read_opts_;
-    snapshot_read_opts_.snapshot = (const rocksdb::Snapshot*)rt->rb_snapshot;
-
-    auto key_set = key_unordered_set();
-    key_set.reserve(rt->actions.size());
-    
+    // every key has only one before-image in the group, just write them back
     auto batch = rocksdb::WriteBatch();
-    for(auto it = rt->actions.begin(); it < rt->actions.end(); it++) {
-        auto data = GETPOINTER(void, it->data);
+    for(auto& act : rt->actions) {
+        auto data = GETPOINTER(void, act.data);
 
-        if(it->f.type == kIssueToken) {
+        if(act.f.type == kIssueToken) {
             // special process issue token action, cuz it's multiple keys
-            auto act = (sp_issuetoken*)data;
-            for(size_t i = 0; i < act->size; i++) {
-                auto  key = get_token_key(act->domain, act->names[i]).as_string();
-                batch.Delete(key);
-
-                // insert key into key set
-                key_set.emplace(std::move(key));
+            auto itact = (sp_issuetoken*)data;
+            for(size_t i = 0; i < itact->size; i++) {
+                auto key = get_token_key(itact->domain, itact->names[i]);
+                batch.Delete(key.as_slice());
+                cache_.remove(key.as_string());
             }
-
-            free(data);
             continue;
         }
 
-        auto op  = 0;
-        auto key = get_sp_keyop(*it, op);
-
-        switch(op) {
-        case kRevert: {
-            // only update operation need to check if key is already processed
-            if(key_set.find(key) != key_set.cend()) {
-                break;
-            }
-            auto old_value = std::string();
-            auto status    = db_->Get(snapshot_read_opts_, key, &old_value);
-            if(!status.ok()) {
-                FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
-            }
-            batch.Put(key, old_value);
-
-            // insert key into key set
-            key_set.emplace(std::move(key));
-            break;
-        }
-        case kRemove: {
-            FC_ASSERT(key_set.find(key) == key_set.cend());
-
-            batch.Delete(key);
-        
-            // insert key into key set
-            key_set.emplace(std::move(key));
-            break;
+        auto img = (sp_image*)data;
+        auto cf  = (act.f.type == kUpdateAsset) ? assets_handle_ : db_->DefaultColumnFamily();
+        if(img->existed()) {
+            batch.Put(cf, img->key(), img->value());
         }
-        case kRemoveOrRevert: {
-            // only update operation need to check if key is already processed
-            if(key_set.find(key) != key_set.cend()) {
-                break;
-            }
-
-            auto old_value = std::string();
-            if(it->f.type == kUpdateAsset) {
-                auto status = db_->Get(snapshot_read_opts_, assets_handle_, key, &old_value);
-
-                // key may not existed in latest snapshot, remove it
-                if(!status.ok()) {
-                    if(status.code() != rocksdb::Status::kNotFound) {
-                        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
-                    }
-                    batch.Delete(assets_handle_, key);
-                }
-                else {
-                    batch.Put(assets_handle_, key, old_value);
-                }
-            }
-            else {
-                auto status = db_->Get(snapshot_read_opts_, key, &old_value);
-
-                // key may not existed in latest snapshot, remove it
-                if(!status.ok()) {
-                    if(status.code() != rocksdb::Status::kNotFound) {
-                        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
-                    }
-                    batch.Delete(key);
-                }
-                else {
-                    batch.Put(key, old_value);
-                }
-            }
-
-            // insert key into key set
-            key_set.emplace(std::move(key));
-            break;
+        else {
+            batch.Delete(cf, img->key());
         }
-        default: {
-            FC_ASSERT(false);
-        }
-        }  // switch
-
-        free(data);
-    }  // for
+        cache_.remove(img->key().ToString());
+    }
 
     auto sync_write_opts = write_opts_;
     sync_write_opts.sync = true;
     db_->Write(sync_write_opts, &batch);
 
-    db_->ReleaseSnapshot((const rocksdb::Snapshot*)rt->rb_snapshot);
     return 0;
 }
 
 int
 token_database::rollback_pd_group(pd_group* pd) {
     using namespace __internal;
+    FC_ASSERT(staging_ == nullptr, "Cannot rollback normal savepoint when staging");
 
     if(pd->actions.empty()) {
         return 0;
@@ -1167,6 +1380,11 @@ token_database::rollback_pd_group(pd_group* pd) {
         }  // switch
     }
 
+    // reverted objects are stale in cache now
+    for(auto& key : key_set) {
+        cache_.remove(key);
+    }
+
     auto sync_write_opts = write_opts_;
     sync_write_opts.sync = true;
     db_->Write(sync_write_opts, &batch);
@@ -1184,7 +1402,12 @@ token_database::rollback_to_latest_savepoint() {
     switch(n.f.type) {
     case kRT: {
         auto rt = GETPOINTER(rt_group, n.group);
-        rollback_rt_group(rt);
+        if(is_staged(savepoints_.back())) {
+            rollback_staged_rt_group(rt, savepoints_.back().seq == staging_seq_);
+        }
+        else {
+            rollback_rt_group(rt);
+        }
         delete rt;
 
         break;
@@ -1250,12 +1473,6 @@ token_database::persist_savepoints() {
         case kRT: {
             auto rt = GETPOINTER(rt_group, n.group);
 
-            auto key_set = key_unordered_set();
-            key_set.reserve(rt->actions.size());
-
-            auto snapshot_read_opts_     = read_opts_;
-            snapshot_read_opts_.snapshot = (const rocksdb::Snapshot*)rt->rb_snapshot;
-
             for(auto& act : rt->actions) {
                 auto data = GETPOINTER(void, act.data);
 
@@ -1263,77 +1480,29 @@ token_database::persist_savepoints() {
                     // special process issue token action, cuz it's multiple keys
                     auto itact = (sp_issuetoken*)data;
                     for(size_t i = 0; i < itact->size; i++) {
-                        auto key   = get_token_key(itact->domain, itact->names[i]).as_string();
                         auto pdact = pd_action();
                         pdact.op   = kRemove;
                         pdact.type = act.f.type;
-                        pdact.key  = key;
+                        pdact.key  = get_token_key(itact->domain, itact->names[i]).as_string();
 
                         pd.actions.emplace_back(std::move(pdact));
-                        key_set.emplace(std::move(key));
                     }
-
-                    free(data);
                     continue;
                 }
 
+                // before-images are unique per key in one group, empty value means key not existed
+                auto img   = (sp_image*)data;
                 auto pdact = pd_action();
-                int  op    = 0;
-                auto key   = get_sp_keyop(act, op);
-
-                pdact.op   = op;
+                pdact.op   = kRemoveOrRevert;
                 pdact.type = act.f.type;
-                pdact.key  = key;
-
-                switch(op) {
-                case kRevert: {
-                    if(key_set.find(key) != key_set.cend()) {
-                        break;
-                    }
-
-                    auto status = db_->Get(snapshot_read_opts_, key, &pdact.value);
-                    if(!status.ok()) {
-                        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
-                    }
-
-                    key_set.emplace(std::move(key));
-                    break;
-                }
-                case kRemove: {
-                    FC_ASSERT(key_set.find(key) == key_set.cend());
-
-                    // no need to read value
-                    key_set.emplace(std::move(key));
-                    break;
+                pdact.key  = img->key().ToString();
+                if(img->existed()) {
+                    pdact.value = img->value().ToString();
                 }
-                case kRemoveOrRevert: {
-                    if(key_set.find(key) != key_set.cend()) {
-                        break;
-                    }
 
-                    rocksdb::Status status;
-                    if(act.f.type == kUpdateAsset) {
-                        status = db_->Get(snapshot_read_opts_, assets_handle_, key, &pdact.value);
-                    }
-                    else {
-                        status = db_->Get(snapshot_read_opts_, key, &pdact.value);
-                    }
-                    
-                    // key may not existed in latest snapshot
-                    if(!status.ok() && status.code() != rocksdb::Status::kNotFound) {
-                        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
-                    }
-
-                    key_set.emplace(std::move(key));
-                    break;
-                }
-                }  // switch
-                
                 pd.actions.emplace_back(std::move(pdact));
-                free(data);
             }
 
-            db_->ReleaseSnapshot((const rocksdb::Snapshot*)rt->rb_snapshot);
             delete rt;
 
             break;
@@ -1390,6 +1559,162 @@ token_database::load_savepoints() {
     return 0;
 }
 
+token_database_snapshot_ptr
+token_database::new_snapshot() const {
+    return std::make_shared<token_database_snapshot>(db_, assets_handle_, read_opts_);
+}
+
+namespace __internal {
+
+template <typename T>
+bool
+read_snapshot_value(rocksdb::DB* db, const rocksdb::ReadOptions& opts, rocksdb::ColumnFamilyHandle* cf, const rocksdb::Slice& key, T& v) {
+    auto value  = std::string();
+    auto status = db->Get(opts, cf, key, &value);
+    if(!status.ok()) {
+        if(status.code() != rocksdb::Status::kNotFound) {
+            FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
+        }
+        return false;
+    }
+    v = read_value<T>(value);
+    return true;
+}
+
+}  // namespace __internal
+
+token_database_snapshot::token_database_snapshot(rocksdb::DB* db, rocksdb::ColumnFamilyHandle* assets_handle, const rocksdb::ReadOptions& read_opts)
+    : db_(db)
+    , assets_handle_(assets_handle)
+    , snapshot_(db->GetSnapshot())
+    , read_opts_(read_opts) {
+    read_opts_.snapshot = snapshot_;
+}
+
+token_database_snapshot::~token_database_snapshot() {
+    db_->ReleaseSnapshot(snapshot_);
+}
+
+int
+token_database_snapshot::exists_domain(const domain_name& name) const {
+    using namespace __internal;
+    auto key   = get_domain_key(name);
+    return db_key_exists(db_, read_opts_, db_->DefaultColumnFamily(), key.as_slice());
+}
+
+int
+token_database_snapshot::exists_token(const domain_name& domain, const token_name& name) const {
+    using namespace __internal;
+    auto key   = get_token_key(domain, name);
+    return db_key_exists(db_, read_opts_, db_->DefaultColumnFamily(), key.as_slice());
+}
+
+int
+token_database_snapshot::exists_asset(const address& addr, const symbol symbol) const {
+    using namespace __internal;
+    auto key   = get_asset_key(addr, symbol);
+    return db_key_exists(db_, read_opts_, assets_handle_, key.as_slice());
+}
+
+int
+token_database_snapshot::read_domain(const domain_name& name, domain_def& domain) const {
+    using namespace __internal;
+    auto key = get_domain_key(name);
+    if(!read_snapshot_value(db_, read_opts_, db_->DefaultColumnFamily(), key.as_slice(), domain)) {
+        vros_THROW(tokendb_domain_not_found, "Cannot find domain: ${name}", ("name",name));
+    }
+    return 0;
+}
+
+int
+token_database_snapshot::read_token(const domain_name& domain, const token_name& name, token_def& token) const {
+    using namespace __internal;
+    auto key = get_token_key(domain, name);
+    if(!read_snapshot_value(db_, read_opts_, db_->DefaultColumnFamily(), key.as_slice(), token)) {
+        vros_THROW(tokendb_token_not_found, "Cannot find token: ${domain}-${name}", ("domain",domain)("name",name));
+    }
+    return 0;
+}
+
+int
+token_database_snapshot::read_group(const group_name& id, group_def& group) const {
+    using namespace __internal;
+    auto key = get_group_key(id);
+    if(!read_snapshot_value(db_, read_opts_, db_->DefaultColumnFamily(), key.as_slice(), group)) {
+        vros_THROW(tokendb_group_not_found, "Cannot find group: ${id}", ("id",id));
+    }
+    group.compile();
+    return 0;
+}
+
+int
+token_database_snapshot::read_suspend(const proposal_name& name, suspend_def& suspend) const {
+    using namespace __internal;
+    auto key = get_suspend_key(name);
+    if(!read_snapshot_value(db_, read_opts_, db_->DefaultColumnFamily(), key.as_slice(), suspend)) {
+        vros_THROW(tokendb_suspend_not_found, "Cannot find suspend: ${name}", ("name",name));
+    }
+    return 0;
+}
+
+int
+token_database_snapshot::read_fungible(const symbol sym, fungible_def& fungible) const {
+    using namespace __internal;
+    auto key = get_fungible_key(sym);
+    if(!read_snapshot_value(db_, read_opts_, db_->DefaultColumnFamily(), key.as_slice(), fungible)) {
+        vros_THROW(tokendb_fungible_not_found, "Cannot find fungible def: ${sym}", ("sym",sym));
+    }
+    return 0;
+}
+
+int
+token_database_snapshot::read_fungible(const symbol_id_type sym_id, fungible_def& fungible) const {
+    using namespace __internal;
+    auto key = get_fungible_key(sym_id);
+    if(!read_snapshot_value(db_, read_opts_, db_->DefaultColumnFamily(), key.as_slice(), fungible)) {
+        vros_THROW(tokendb_fungible_not_found, "Cannot find fungible def: ${id}", ("id",sym_id));
+    }
+    return 0;
+}
+
+int
+token_database_snapshot::read_asset(const address& addr, const symbol symbol, asset& v) const {
+    using namespace __internal;
+    auto key = get_asset_key(addr, symbol);
+    if(!read_snapshot_value(db_, read_opts_, assets_handle_, key.as_slice(), v)) {
+        vros_THROW(tokendb_asset_not_found, "Cannot find fungible: ${sym} in address: {addr}", ("sym",symbol)("addr",addr));
+    }
+    return 0;
+}
+
+int
+token_database_snapshot::read_asset_no_throw(const address& addr, const symbol symbol, asset& v) const {
+    using namespace __internal;
+    auto key = get_asset_key(addr, symbol);
+    if(!read_snapshot_value(db_, read_opts_, assets_handle_, key.as_slice(), v)) {
+        v = asset(0, symbol);
+    }
+    return 0;
+}
+
+int
+token_database_snapshot::read_all_assets(const address& addr, const read_fungible_func& func) const {
+    using namespace __internal;
+    auto it  = db_->NewIterator(read_opts_, assets_handle_);
+    auto key = get_asset_prefix_key(addr);
+    it->Seek(key.as_slice());
+
+    while(it->Valid() && it->key().starts_with(key.as_slice())) {
+        auto v = read_value<asset>(it->value());
+        if(!func(v)) {
+            break;
+        }
+        it->Next();
+    }
+    delete it;
+    return 0;
+}
+
 }}  // namespace vros::chain
 
 FC_REFLECT(vros::chain::__internal::pd_header, (dirty_flag));
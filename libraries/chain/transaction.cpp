@@ -10,36 +10,15 @@
 #include <boost/iostreams/device/back_inserter.hpp>
 #include <boost/iostreams/filter/zlib.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
-#include <boost/multi_index/hashed_index.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/sequenced_index.hpp>
-#include <boost/multi_index_container.hpp>
 #include <boost/range/adaptor/transformed.hpp>
 
 #include <vros/chain/exceptions.hpp>
 #include <vros/chain/transaction.hpp>
+#include <vros/chain/signature_cache.hpp>
 #include <vros/chain/config.hpp>
 
 namespace vros { namespace chain {
 
-using namespace boost::multi_index;
-
-struct cached_pub_key {
-    transaction_id_type trx_id;
-    public_key_type     pub_key;
-    signature_type      sig;
-    cached_pub_key(const cached_pub_key&) = delete;
-    cached_pub_key()                      = delete;
-    cached_pub_key& operator=(const cached_pub_key&) = delete;
-    cached_pub_key(cached_pub_key&&)                 = default;
-};
-struct by_sig {};
-
-typedef multi_index_container<
-    cached_pub_key,
-    indexed_by<sequenced<>, hashed_unique<tag<by_sig>, member<cached_pub_key, signature_type, &cached_pub_key::sig>>>>
-    recovery_cache_type;
-
 void
 transaction_header::set_reference_block(const block_id_type& reference_block) {
     ref_block_num    = fc::endian_reverse_u32(reference_block._hash[0]);
@@ -76,24 +55,13 @@ transaction::get_signature_keys(const vector<signature_type>& signatures, const
     try {
         using boost::adaptors::transformed;
 
-        constexpr size_t           recovery_cache_size = 1000;
-        static recovery_cache_type recovery_cache;
-        const digest_type          digest = sig_digest(chain_id);
+        const digest_type digest = sig_digest(chain_id);
 
         flat_set<public_key_type> recovered_pub_keys;
         for(const signature_type& sig : signatures) {
-            recovery_cache_type::index<by_sig>::type::iterator it = recovery_cache.get<by_sig>().find(sig);
-
             public_key_type recov;
             if(use_cache) {
-                if(it == recovery_cache.get<by_sig>().end() || it->trx_id != id()) {
-                    recov = public_key_type(sig, digest);
-                    recovery_cache.emplace_back(
-                        cached_pub_key{id(), recov, sig});  // could fail on dup signatures; not a problem
-                }
-                else {
-                    recov = it->pub_key;
-                }
+                recov = signature_cache::instance().recover(sig, digest);
             }
             else {
                 recov = public_key_type(sig, digest);
@@ -106,12 +74,6 @@ transaction::get_signature_keys(const vector<signature_type>& signatures, const
                        ("key", recov));
         }
 
-        if(use_cache) {
-            while(recovery_cache.size() > recovery_cache_size) {
-                recovery_cache.erase(recovery_cache.begin());
-            }
-        }
-
         return recovered_pub_keys;
     }
     FC_CAPTURE_AND_RETHROW()
@@ -31,8 +31,14 @@ transaction_context::init() {
     
     check_time();    // Fail early if deadline has already been exceeded
     if(!control.charge_free_mode()) {
-        check_charge();  // Fail early if max charge has already been exceeded
-        check_paid();    // Fail early if theren't no remainning avaiable vros & Pinned vros tokens
+        if(control.skip_trx_checks()) {
+            // replaying irreversible block, charge is only needed to pay
+            charge = control.get_charge_manager().calculate(trx.packed_trx);
+        }
+        else {
+            check_charge();  // Fail early if max charge has already been exceeded
+            check_paid();    // Fail early if theren't no remainning avaiable vros & Pinned vros tokens
+        }
     }
     is_initialized = true;
 }
@@ -46,7 +52,7 @@ void
 transaction_context::init_for_input_trx(uint32_t num_signatures) {
     auto& t  = trx.trx;
     is_input = true;
-    if(!control.loadtest_mode()) {
+    if(!control.loadtest_mode() && !control.skip_trx_checks()) {
         control.validate_expiration(t);
         control.validate_tapos(t);
     }
@@ -65,8 +71,7 @@ transaction_context::exec() {
     vros_ASSERT(is_initialized, transaction_exception, "must first initialize");
 
     for(const auto& act : trx.trx.actions) {
-        trace->action_traces.emplace_back();
-        dispatch_action(trace->action_traces.back(), act);
+        dispatch_action(act);
     }
 }
 
@@ -141,12 +146,15 @@ transaction_context::check_paid() const {
     }
     }  // switch
     
-    asset vros, pvros;
-    tokendb.read_asset_no_throw(payer, pvros_sym(), pvros);
+    // both balances are read in one batch, paycharge will hit them in cache later
+    auto assets = std::vector<asset>();
+    tokendb.read_assets({ { payer, pvros_sym() }, { payer, vros_sym() } }, assets);
+
+    auto& pvros = assets[0];
+    auto& vros  = assets[1];
     if(pvros.amount() > charge) {
         return;
     }
-    tokendb.read_asset_no_throw(payer, vros_sym(), vros);
     if(pvros.amount() + vros.amount() >= charge) {
         return;
     }
@@ -176,6 +184,16 @@ transaction_context::finalize_pay() {
     }
     }  // switch
 
+    dispatch_action(act);
+}
+
+void
+transaction_context::dispatch_action(const action& act) {
+    if(!record_traces) {
+        apply_context apply(control, *this, act);
+        apply.exec();
+        return;
+    }
     trace->action_traces.emplace_back();
     dispatch_action(trace->action_traces.back(), act);
 }